@@ -0,0 +1,90 @@
+#ifndef MAPPEDARRAY_H
+#define MAPPEDARRAY_H
+
+#include "AlignedAllocator.h"
+#include <cstddef>
+#include <initializer_list>
+
+// Arreglo que posee su memoria (alineada) o apunta a memoria externa de solo
+// lectura, p. ej. un bloque de un archivo proyectado. Leer una vista no
+// copia nada; la primera escritura la convierte en copia propia.
+template <typename T> class MappedArray {
+public:
+  using value_type = T;
+  using iterator = T *;
+  using const_iterator = const T *;
+
+  MappedArray() = default;
+  MappedArray(std::initializer_list<T> list) : owned(list) {}
+
+  MappedArray &operator=(std::initializer_list<T> list) {
+    clear();
+    owned.assign(list);
+    return *this;
+  }
+
+  // Apunta a memoria externa; quien llama garantiza que sobreviva al arreglo
+  void attach(const T *data, size_t n) {
+    owned = AlignedVector<T>();
+    view = data;
+    viewSize = n;
+  }
+  bool mapped() const { return view != nullptr; }
+
+  size_t size() const { return view ? viewSize : owned.size(); }
+  bool empty() const { return size() == 0; }
+
+  const T *data() const { return view ? view : owned.data(); }
+  T *data() {
+    detach();
+    return owned.data();
+  }
+
+  const T &operator[](size_t i) const { return data()[i]; }
+  T &operator[](size_t i) {
+    detach();
+    return owned[i];
+  }
+
+  const T *begin() const { return data(); }
+  const T *end() const { return data() + size(); }
+  T *begin() { return data(); }
+  T *end() { return data() + size(); }
+
+  void push_back(const T &v) {
+    detach();
+    owned.push_back(v);
+  }
+  void reserve(size_t n) {
+    detach();
+    owned.reserve(n);
+  }
+  void resize(size_t n) {
+    detach();
+    owned.resize(n);
+  }
+  void resize(size_t n, const T &v) {
+    detach();
+    owned.resize(n, v);
+  }
+  void clear() {
+    view = nullptr;
+    viewSize = 0;
+    owned.clear();
+  }
+
+private:
+  void detach() {
+    if (view) {
+      owned.assign(view, view + viewSize);
+      view = nullptr;
+      viewSize = 0;
+    }
+  }
+
+  AlignedVector<T> owned;
+  const T *view = nullptr;
+  size_t viewSize = 0;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// Archivo de solo lectura proyectado en memoria (mmap / MapViewOfFile).
+// El contenido se lee directamente de la cache de paginas, sin copias.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool open(const std::string &path);
+  void close();
+
+  const char *data() const { return ptr; }
+  size_t size() const { return length; }
+
+private:
+  const char *ptr = nullptr;
+  size_t length = 0;
+#ifdef _WIN32
+  void *fileHandle = nullptr;
+  void *mapHandle = nullptr;
+#else
+  int fd = -1;
+#endif
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+
+// Cola circular sin bloqueos para un solo productor y un solo consumidor.
+// Capacidad fija N (potencia de 2); push/pop fallan si esta llena/vacia.
+template <typename T, size_t N> class SpscRing {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "N debe ser potencia de 2");
+
+public:
+  bool push(const T &value) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == N)
+      return false;
+    items[t & (N - 1)] = value;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T &value) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire))
+      return false;
+    value = items[h & (N - 1)];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_acquire);
+  }
+
+  // Solo cuando ningun otro hilo usa la cola
+  void reset() {
+    head.store(0);
+    tail.store(0);
+  }
+
+private:
+  // En lineas de cache distintas para que productor y consumidor no se pisen
+  alignas(64) std::atomic<size_t> head{0};
+  alignas(64) std::atomic<size_t> tail{0};
+  T items[N];
+};
+
+#endif
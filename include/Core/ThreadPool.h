@@ -0,0 +1,52 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Pool de hilos persistente. parallelFor reparte indices [0, count) entre los
+// trabajadores y el hilo que llama; solo se sincroniza al inicio y al final
+// de cada trabajo, nunca por elemento.
+class ThreadPool {
+public:
+  // threads = 0 usa todos los nucleos disponibles
+  explicit ThreadPool(int threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Hilos que participan en un trabajo (incluye al que llama)
+  int size() const { return (int)workers.size() + 1; }
+
+  template <typename Fn> void parallelFor(int count, Fn &&fn) {
+    using F = std::remove_reference_t<Fn>;
+    run(count, [](void *ctx, int i) { (*static_cast<F *>(ctx))(i); },
+        (void *)&fn);
+  }
+
+private:
+  using Task = void (*)(void *, int);
+
+  void run(int count, Task task, void *ctx);
+  void drain();
+  void workerLoop();
+
+  std::vector<std::thread> workers;
+  std::mutex mtx;
+  std::condition_variable cvWork, cvDone;
+
+  Task jobTask = nullptr;
+  void *jobCtx = nullptr;
+  int jobCount = 0;
+  std::atomic<int> next{0};
+  int active = 0;
+  unsigned generation = 0;
+  bool stop = false;
+};
+
+#endif
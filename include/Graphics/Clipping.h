@@ -0,0 +1,158 @@
+#ifndef CLIPPING_H
+#define CLIPPING_H
+
+#include "../Math/Mat4.h"
+#include "../Math/Vec3.h"
+#include "../Math/Vec4.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Vertice en espacio de recorte: x, y de clip (antes de dividir por w),
+// z de vista (la profundidad que usa el z-buffer), w e intensidad. Antes de
+// la division todo se interpola linealmente.
+struct ClipVertex {
+  float x, y, z, w, i;
+};
+
+inline ClipVertex lerp(const ClipVertex &a, const ClipVertex &b, float t) {
+  return {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t,
+          a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t,
+          a.i + (b.i - a.i) * t};
+}
+
+// Un bit por plano; el de near va primero para que los demas ya vean w > 0
+enum ClipCode : uint8_t {
+  CLIP_NEAR = 1 << 0,
+  CLIP_FAR = 1 << 1,
+  CLIP_LEFT = 1 << 2,
+  CLIP_RIGHT = 1 << 3,
+  CLIP_TOP = 1 << 4,
+  CLIP_BOTTOM = 1 << 5,
+};
+constexpr int CLIP_PLANE_COUNT = 6;
+
+// Planos near/far en z de vista y banda de guarda en pixeles desde el
+// centro. La banda es mas ancha que la pantalla: lo que cae dentro se
+// rasteriza sin recortar (el rasterizador ya acota a la pantalla) y solo
+// se recorta lo que saldria de ella, que ademas dejaria coordenadas fuera
+// del rango de los kernels SIMD.
+struct ClipPlanes {
+  float nearZ, farZ, guardX, guardY;
+
+  // >= 0 dentro del plano
+  float distance(const ClipVertex &v, int plane) const {
+    switch (plane) {
+    case 0:
+      return v.z - nearZ;
+    case 1:
+      return farZ - v.z;
+    case 2:
+      return v.x + guardX * v.w;
+    case 3:
+      return guardX * v.w - v.x;
+    case 4:
+      return v.y + guardY * v.w;
+    default:
+      return guardY * v.w - v.y;
+    }
+  }
+};
+
+// Capacidad de un poligono recortado: 3 vertices + 1 por plano
+constexpr int CLIP_MAX_VERTICES = 3 + CLIP_PLANE_COUNT;
+
+// Sutherland-Hodgman contra los planos de 'mask'. 'poly' trae n vertices y
+// recibe el resultado (0 si no queda nada); 'scratch' es de apoyo. Ambos
+// con lugar para CLIP_MAX_VERTICES.
+inline int clipPolygon(const ClipPlanes &p, uint8_t mask, ClipVertex *poly,
+                       int n, ClipVertex *scratch) {
+  ClipVertex *in = poly, *out = scratch;
+  for (int plane = 0; plane < CLIP_PLANE_COUNT && n > 0; plane++) {
+    if (!(mask & (1 << plane)))
+      continue;
+    int m = 0;
+    for (int k = 0; k < n; k++) {
+      const ClipVertex &a = in[k], &b = in[(k + 1) % n];
+      float da = p.distance(a, plane), db = p.distance(b, plane);
+      if (da >= 0)
+        out[m++] = a;
+      if ((da >= 0) != (db >= 0))
+        out[m++] = lerp(a, b, da / (da - db));
+    }
+    n = m;
+    ClipVertex *t = in;
+    in = out;
+    out = t;
+  }
+  if (in != poly)
+    for (int k = 0; k < n; k++)
+      poly[k] = in[k];
+  return n;
+}
+
+// Recorta el segmento a-b (parametrico, Liang-Barsky). false si queda fuera
+inline bool clipSegment(const ClipPlanes &p, uint8_t mask, ClipVertex &a,
+                        ClipVertex &b) {
+  float t0 = 0.0f, t1 = 1.0f;
+  for (int plane = 0; plane < CLIP_PLANE_COUNT; plane++) {
+    if (!(mask & (1 << plane)))
+      continue;
+    float da = p.distance(a, plane), db = p.distance(b, plane);
+    if (da < 0 && db < 0)
+      return false;
+    if (da < 0)
+      t0 = std::max(t0, da / (da - db));
+    else if (db < 0)
+      t1 = std::min(t1, da / (da - db));
+  }
+  if (t0 > t1)
+    return false;
+  ClipVertex s = a;
+  a = lerp(s, b, t0);
+  b = lerp(s, b, t1);
+  return true;
+}
+
+// Piramide de vista como seis planos en espacio de vista (n . v + d >= 0
+// dentro, n unitaria) para descartar esferas envolventes antes de
+// transformar vertices. Los laterales salen de la proyeccion: x / w + cx
+// cae en la pantalla si x + cx w >= 0 y cx w - x >= 0, que es lineal en v.
+struct Frustum {
+  Vec4 planes[6];
+
+  // 'margin' en pixeles: la rasterizacion trunca las coordenadas, asi que
+  // algo apenas fuera todavia puede tocar el borde
+  static Frustum fromProjection(const Mat4 &proj, float cx, float cy,
+                                float nearZ, float farZ, float margin = 1) {
+    auto row = [&](int i) {
+      return Vec4(proj.m[i][0], proj.m[i][1], proj.m[i][2], proj.m[i][3]);
+    };
+    auto combine = [](const Vec4 &a, float s, const Vec4 &w, float t) {
+      return Vec4(a.x * s + w.x * t, a.y * s + w.y * t, a.z * s + w.z * t,
+                  a.w * s + w.w * t);
+    };
+    Vec4 x = row(0), y = row(1), w = row(3);
+    cx += margin;
+    cy += margin;
+    Frustum f = {{combine(x, 1, w, cx), combine(x, -1, w, cx),
+                  combine(y, 1, w, cy), combine(y, -1, w, cy),
+                  Vec4(0, 0, 1, -nearZ), Vec4(0, 0, -1, farZ)}};
+    for (Vec4 &p : f.planes) {
+      float len = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+      if (len > 0)
+        p = Vec4(p.x / len, p.y / len, p.z / len, p.w / len);
+    }
+    return f;
+  }
+
+  // true si la esfera queda entera fuera de algun plano
+  bool culls(const Vec3 &c, float radius) const {
+    for (const Vec4 &p : planes)
+      if (p.x * c.x + p.y * c.y + p.z * c.z + p.w < -radius)
+        return true;
+    return false;
+  }
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef FRAMESINK_H
+#define FRAMESINK_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+// Frame terminado: pixeles ARGB8888 fila a fila, sin relleno entre filas.
+// Solo es valido durante la llamada al sink.
+struct Frame {
+  const uint32_t *pixels;
+  int width, height;
+  int index; // Numero de frame desde init
+};
+
+// Destino de los frames en modo sin ventana. Devuelve false si no pudo
+// escribir (disco lleno, pipe cerrado...); cualquier funcion sirve de
+// callback.
+using FrameSink = std::function<bool(const Frame &)>;
+
+namespace FrameSinks {
+// Un PPM (P6) por frame. El patron lleva un entero estilo printf para el
+// numero de frame, p. ej. "frame_%04d.ppm". Con un patron invalido devuelve
+// un sink vacio.
+FrameSink ppmFiles(const std::string &pattern);
+
+// Exactamente un %d o %0Nd y ningun otro '%' salvo "%%": lo unico que se
+// puede pasar a printf sin riesgo y que da un archivo distinto por frame.
+bool validPattern(const std::string &pattern);
+
+// Frames ARGB8888 crudos, uno tras otro, a un FILE* ya abierto (stdout por
+// defecto). En memoria son BGRA, p. ej. para
+// "ffmpeg -f rawvideo -pix_fmt bgra -s 800x600 -i - salida.mp4".
+FrameSink rawPipe(FILE *out = stdout);
+} // namespace FrameSinks
+
+#endif
@@ -1,22 +1,74 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include "../Core/MappedArray.h"
+#include "../Core/MappedFile.h"
 #include "../Math/Vec3.h"
+#include "../Math/Vec3Array.h"
 #include <cstdint>
-#include <vector>
+#include <memory>
+#include <type_traits>
 
 struct Face {
   int a, b, c; // Indices de los vertices
   uint32_t color;
 };
 
+// Tramo de caras consecutivas (meshlet) con la esfera que las envuelve y el
+// cono de sus normales, para descartar de una vez lo que queda fuera de la
+// vista o de espaldas. [firstVertex, endVertex) cubre todos los vertices
+// que usan sus caras.
+struct MeshCluster {
+  uint32_t firstFace, faceCount;
+  uint32_t firstVertex, endVertex;
+  Vec3 center;
+  float radius;
+  Vec3 coneAxis;    // Normal media (unitaria)
+  float coneCutoff; // Seno del semiangulo del cono; > 1 = sin cono
+};
+static_assert(std::is_trivially_copyable<MeshCluster>::value,
+              "MeshCluster se guarda tal cual en la cache");
+
 class Mesh {
 public:
-  std::vector<Vec3> vertices;
-  std::vector<Face> faces;
+  Vec3Array vertices; // SoA: x[], y[], z[] alineados
+  Vec3Array normals;  // Normales por vertice en espacio de modelo
+  MappedArray<Face> faces;
+  Vec3 boundsMin, boundsMax; // Caja envolvente en espacio de modelo
+  Vec3 boundsCenter;         // Esfera envolvente; radio < 0 = sin calcular
+  float boundsRadius = -1.0f;
+  // Opcional: si esta vacio (o no cubre todas las caras) la malla se
+  // descarta entera o nada
+  MappedArray<MeshCluster> clusters;
+
+  // Archivo que respalda los arreglos cuando vienen de una cache binaria
+  // (vistas sin copia); se comparte entre copias de la malla.
+  std::shared_ptr<const MappedFile> storage;
 
   void addCube(); // Mantener la funcionalidad original
                   // Futuro: loadFromObj()
+
+  // Normal por vertice = promedio de las normales de sus caras (ponderadas
+  // por area). Se calcula una vez al cargar; el render solo la rota.
+  void computeNormals() { computeNormals(normals); }
+  void computeNormals(Vec3Array &out) const;
+  bool hasNormals() const { return normals.size() == vertices.size(); }
+
+  // Caja y esfera de toda la malla. Hay que volver a llamarla (y a
+  // buildClusters) si se editan los vertices.
+  void computeBounds();
+
+  // Agrupa las caras en meshlets compactos de hasta maxFaces caras (de
+  // minFaces en adelante solo si el cono de normales sigue cerrado;
+  // maxFaces = 0: sin clusters). Reordena caras y vertices para que cada
+  // meshlet sea un tramo consecutivo. OBJLoader lo hace al cargar y la
+  // cache los guarda.
+  static constexpr uint32_t CLUSTER_MIN_FACES = 64;
+  static constexpr uint32_t CLUSTER_MAX_FACES = 128;
+  static constexpr float CLUSTER_CONE_SPLIT = 0.7071f; // cos 45 grados
+  void buildClusters(uint32_t maxFaces = CLUSTER_MAX_FACES,
+                     uint32_t minFaces = CLUSTER_MIN_FACES);
+  bool hasClusters() const;
 };
 
 #endif
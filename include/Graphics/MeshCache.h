@@ -0,0 +1,47 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include "Mesh.h"
+#include <cstdint>
+#include <string>
+
+// Cache binaria de una malla, guardada junto al .obj de origen. Tras una
+// cabecera fija van los bloques x, y, z de vertices y normales, las caras y
+// los clusters, cada uno alineado a 32 bytes, en el formato nativo de la
+// maquina. Cargarla solo proyecta el archivo: los arreglos de la malla
+// apuntan a los bloques.
+class MeshCache {
+public:
+  static constexpr uint32_t VERSION = 3;
+  static constexpr size_t BLOCK_ALIGN = 32;
+  static constexpr int BLOCK_COUNT = 8;
+
+  struct Header {
+    char magic[8]; // "CUBEMESH"
+    uint32_t version;
+    // sizeof(Face) y sizeof(MeshCluster), detectan cambios de layout
+    uint16_t faceSize, clusterSize;
+    uint64_t vertexCount, faceCount, clusterCount;
+    uint64_t sourceSize; // Tamano y fecha del .obj: si cambian, se regenera
+    int64_t sourceTime;
+    float boundsMin[3], boundsMax[3];
+    float boundsCenter[3], boundsRadius;
+    uint64_t blocks[BLOCK_COUNT]; // Offsets: x, y, z, nx, ny, nz, caras,
+                                  // clusters
+  };
+
+  // "modelo.obj" -> "modelo.obj.meshbin"
+  static std::string pathFor(const std::string &source) {
+    return source + ".meshbin";
+  }
+
+  // Proyecta la cache si existe y corresponde a la version actual del
+  // archivo de origen; si no, devuelve false sin tocar la malla.
+  static bool load(const std::string &source, Mesh &mesh);
+
+  // Escribe la cache (a un temporal que luego se renombra, para que otro
+  // proceso nunca lea un archivo a medias).
+  static bool save(const std::string &source, const Mesh &mesh);
+};
+
+#endif
@@ -1,58 +1,343 @@
 #ifndef OBJLOADER_H
 #define OBJLOADER_H
 
+#include "../Core/MappedFile.h"
+#include "../Core/ThreadPool.h"
 #include "../Graphics/Mesh.h"
-#include <fstream>
+#include "../Graphics/MeshCache.h"
+#include <algorithm>
+#include <cfloat>
+#include <charconv>
+#include <cstring>
 #include <iostream>
-#include <sstream>
 #include <string>
-
+#include <vector>
 
 class OBJLoader {
-public:
-  static bool load(const std::string &filename, Mesh &mesh) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-      std::cerr << "Error: No se pudo abrir " << filename << std::endl;
+private:
+  // Datos parseados de un rango del archivo. Los indices positivos ya son
+  // globales; los negativos se resuelven contra lo leido en el bloque y se
+  // anotan (cara * 3 + esquina) para sumarles la base global al unir.
+  struct ObjChunk {
+    Vec3Array vertices;
+    std::vector<Vec3> normals;      // Registros "vn"
+    std::vector<Face> faces;
+    std::vector<int> cornerNormals; // Indice "vn" de cada esquina (-1 = no)
+    std::vector<uint32_t> relativeVertices, relativeNormals;
+  };
+
+  // Esquina de cara ya parseada
+  struct Corner {
+    int v, vn;
+    bool relV, relN; // Indice relativo al bloque (venia negativo)
+  };
+
+  // Bloques mas chicos no compensan repartirlos entre hilos
+  static constexpr size_t MIN_CHUNK_BYTES = 4 << 20;
+
+  // Usa las normales "vn" si todas las esquinas tienen una (promediando las
+  // de cada vertice); si no, las calcula a partir de las caras.
+  static void resolveNormals(Mesh &mesh, const std::vector<Vec3> &normals,
+                             const std::vector<int> &corners) {
+    bool complete = !corners.empty();
+    for (int n : corners)
+      if (n < 0 || n >= (int)normals.size())
+        complete = false;
+    if (!complete) {
+      mesh.computeNormals();
+      return;
+    }
+
+    mesh.normals.clear();
+    mesh.normals.resize(mesh.vertices.size());
+    for (size_t f = 0; f < mesh.faces.size(); f++) {
+      const Face &face = mesh.faces[f];
+      int v[3] = {face.a, face.b, face.c};
+      for (int i = 0; i < 3; i++) {
+        Vec3 n = normals[corners[f * 3 + i]];
+        mesh.normals.set(v[i], mesh.normals[v[i]] + n);
+      }
+    }
+    for (size_t i = 0; i < mesh.normals.size(); i++) {
+      Vec3 n = mesh.normals[i];
+      n.normalize();
+      mesh.normals.set(i, n);
+    }
+  }
+
+  // --- Tokenizador sobre el buffer proyectado (sin copias ni strings) ---
+
+  static const char *skipSpaces(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t'))
+      p++;
+    return p;
+  }
+
+  // Orden de magnitud decimal de un numero ya validado por from_chars en
+  // [p, end): alcanza para saber hacia donde se salio del rango de float
+  static long decimalExponent(const char *p, const char *end) {
+    if (p < end && *p == '-')
+      p++;
+    long lead = 0, zeros = 0;
+    bool nonZero = false;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+      if (nonZero || *p != '0') {
+        nonZero = true;
+        lead++;
+      }
+    }
+    if (p < end && *p == '.') {
+      for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+        if (!nonZero && *p == '0')
+          zeros++;
+        else
+          nonZero = true;
+      }
+    }
+    long exponent = 0;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+      p++;
+      bool negative = p < end && *p == '-';
+      if (p < end && (*p == '-' || *p == '+'))
+        p++;
+      for (; p < end && *p >= '0' && *p <= '9'; p++)
+        exponent = std::min(exponent * 10 + (*p - '0'), 100000L);
+      if (negative)
+        exponent = -exponent;
+    }
+    return exponent + (lead > 0 ? lead - 1 : -(zeros + 1));
+  }
+
+  static bool parseFloat(const char *&p, const char *end, float &out) {
+    p = skipSpaces(p, end);
+    if (p < end && *p == '+') // from_chars no acepta '+'
+      p++;
+    auto res = std::from_chars(p, end, out);
+    if (res.ec == std::errc::result_out_of_range) {
+      // Exponentes como 1e-50 o 1e400: se satura en vez de perder el valor
+      float limit = decimalExponent(p, res.ptr) < 0 ? 0.0f : FLT_MAX;
+      out = *p == '-' ? -limit : limit;
+    } else if (res.ec != std::errc()) {
       return false;
     }
+    p = res.ptr;
+    return true;
+  }
+
+  // Los registros "v" y "vn" se guardan siempre, aunque falten componentes
+  // (quedan en 0): saltear uno correria los indices de todas las caras
+  // siguientes
+  static Vec3 parseVec3(const char *p, const char *end) {
+    Vec3 v;
+    if (parseFloat(p, end, v.x) && parseFloat(p, end, v.y))
+      parseFloat(p, end, v.z);
+    return v;
+  }
+
+  static bool parseInt(const char *&p, const char *end, int &out) {
+    if (p < end && *p == '+')
+      p++;
+    auto res = std::from_chars(p, end, out);
+    if (res.ec != std::errc())
+      return false;
+    p = res.ptr;
+    return true;
+  }
 
-    std::vector<Vec3> temp_vertices;
-    std::string line;
-
-    while (std::getline(file, line)) {
-      std::stringstream ss(line);
-      std::string prefix;
-      ss >> prefix;
-
-      if (prefix == "v") { // Vertice
-        Vec3 v;
-        ss >> v.x >> v.y >> v.z;
-        mesh.vertices.push_back(v);
-      } else if (prefix == "f") { // Cara
-        Face f;
-        // Parseo simplificado para formatos "v", "v/vt", "v/vt/vn"
-        // Asumimos triangulos (3 indices)
-        std::string segment;
-        int indices[3];
-        for (int i = 0; i < 3; i++) {
-          ss >> segment;
-          // Buscar primer '/' para tomar solo el indice del vertice
-          size_t slash = segment.find('/');
-          if (slash != std::string::npos) {
-            indices[i] = std::stoi(segment.substr(0, slash));
-          } else {
-            indices[i] = std::stoi(segment);
-          }
+  // OBJ usa indices 1-based; los negativos son relativos al final
+  static int resolveIndex(int idx, int count, bool &relative) {
+    relative = idx < 0;
+    return idx > 0 ? idx - 1 : count + idx;
+  }
+
+  // Esquina de cara: "v", "v/vt", "v//vn" o "v/vt/vn"
+  static bool parseCorner(const char *&p, const char *end,
+                          const ObjChunk &chunk, Corner &c) {
+    int idx;
+    if (!parseInt(p, end, idx) || idx == 0)
+      return false;
+    c.v = resolveIndex(idx, (int)chunk.vertices.size(), c.relV);
+    c.vn = -1;
+    c.relN = false;
+    if (p < end && *p == '/') {
+      p++;
+      int vt;
+      if (p < end && *p != '/')
+        parseInt(p, end, vt); // Coordenadas de textura: no se usan
+      if (p < end && *p == '/') {
+        p++;
+        if (parseInt(p, end, idx) && idx != 0)
+          c.vn = resolveIndex(idx, (int)chunk.normals.size(), c.relN);
+      }
+    }
+    return true;
+  }
+
+  static void pushCorner(ObjChunk &out, const Corner &c) {
+    uint32_t slot = (uint32_t)out.cornerNormals.size();
+    if (c.relV)
+      out.relativeVertices.push_back(slot);
+    if (c.relN)
+      out.relativeNormals.push_back(slot);
+    out.cornerNormals.push_back(c.vn);
+  }
+
+  // Parsea las lineas de [p, end). Las caras de mas de 3 vertices se
+  // triangulan en abanico.
+  static void parseRange(const char *p, const char *end, ObjChunk &out) {
+    while (p < end) {
+      const char *line = skipSpaces(p, end);
+      if (line == end)
+        break;
+      size_t rest = (size_t)(end - line);
+      const char *eol = (const char *)std::memchr(line, '\n', rest);
+      if (!eol)
+        eol = end;
+      p = eol < end ? eol + 1 : end;
+      if (line == eol)
+        continue;
+
+      if (line[0] == 'v' && eol - line > 1 &&
+          (line[1] == ' ' || line[1] == '\t')) {
+        out.vertices.push_back(parseVec3(line + 1, eol)); // Vertice
+      } else if (line[0] == 'v' && eol - line > 2 && line[1] == 'n' &&
+                 (line[2] == ' ' || line[2] == '\t')) {
+        out.normals.push_back(parseVec3(line + 2, eol)); // Normal
+      } else if (line[0] == 'f' && eol - line > 1 &&
+                 (line[1] == ' ' || line[1] == '\t')) {
+        const char *q = line + 1; // Cara
+        Corner c0, c1, c2;
+        q = skipSpaces(q, eol);
+        if (!parseCorner(q, eol, out, c0))
+          continue;
+        q = skipSpaces(q, eol);
+        if (!parseCorner(q, eol, out, c1))
+          continue;
+        for (;;) {
+          q = skipSpaces(q, eol);
+          if (q >= eol || *q == '\r' || *q == '#' ||
+              !parseCorner(q, eol, out, c2))
+            break;
+          out.faces.push_back({c0.v, c1.v, c2.v, 0xFFFFFF}); // Blanco
+          pushCorner(out, c0);
+          pushCorner(out, c1);
+          pushCorner(out, c2);
+          c1 = c2;
         }
-        // OBJ usa indices 1-based, pasamos a 0-based
-        f.a = indices[0] - 1;
-        f.b = indices[1] - 1;
-        f.c = indices[2] - 1;
-        f.color = 0xFFFFFF; // Blanco por defecto
-        mesh.faces.push_back(f);
       }
     }
+  }
+
+  // Une los bloques en orden: corrige los indices relativos con la base
+  // global de cada bloque y copia cada uno a su posicion final en paralelo
+  static void merge(std::vector<ObjChunk> &chunks, ThreadPool &pool,
+                    Mesh &mesh, std::vector<Vec3> &normals,
+                    std::vector<int> &corners) {
+    size_t n = chunks.size();
+    std::vector<size_t> vBase(n + 1, 0), nBase(n + 1, 0), fBase(n + 1, 0);
+    for (size_t k = 0; k < n; k++) {
+      vBase[k + 1] = vBase[k] + chunks[k].vertices.size();
+      nBase[k + 1] = nBase[k] + chunks[k].normals.size();
+      fBase[k + 1] = fBase[k] + chunks[k].faces.size();
+    }
+    mesh.vertices.clear();
+    mesh.faces.clear();
+    mesh.vertices.resize(vBase[n]);
+    mesh.faces.resize(fBase[n]);
+    normals.resize(nBase[n]);
+    corners.resize(fBase[n] * 3);
+
+    pool.parallelFor((int)n, [&](int k) {
+      ObjChunk &c = chunks[k];
+      for (uint32_t slot : c.relativeVertices) {
+        Face &f = c.faces[slot / 3];
+        int &idx = slot % 3 == 0 ? f.a : slot % 3 == 1 ? f.b : f.c;
+        idx += (int)vBase[k];
+      }
+      for (uint32_t slot : c.relativeNormals)
+        c.cornerNormals[slot] += (int)nBase[k];
+
+      std::copy(c.vertices.x.begin(), c.vertices.x.end(),
+                mesh.vertices.x.begin() + vBase[k]);
+      std::copy(c.vertices.y.begin(), c.vertices.y.end(),
+                mesh.vertices.y.begin() + vBase[k]);
+      std::copy(c.vertices.z.begin(), c.vertices.z.end(),
+                mesh.vertices.z.begin() + vBase[k]);
+      std::copy(c.normals.begin(), c.normals.end(),
+                normals.begin() + nBase[k]);
+      std::copy(c.faces.begin(), c.faces.end(), mesh.faces.begin() + fBase[k]);
+      std::copy(c.cornerNormals.begin(), c.cornerNormals.end(),
+                corners.begin() + fBase[k] * 3);
+      c = ObjChunk(); // Libera el bloque cuanto antes
+    });
+
+    // Descarta caras con indices fuera de rango en vez de romper el render
+    int count = (int)mesh.vertices.size();
+    auto valid = [count](int i) { return i >= 0 && i < count; };
+    size_t kept = 0;
+    for (size_t f = 0; f < mesh.faces.size(); f++) {
+      const Face &face = mesh.faces[f];
+      if (!valid(face.a) || !valid(face.b) || !valid(face.c))
+        continue;
+      mesh.faces[kept] = face;
+      for (int i = 0; i < 3; i++)
+        corners[kept * 3 + i] = corners[f * 3 + i];
+      kept++;
+    }
+    mesh.faces.resize(kept);
+    corners.resize(kept * 3);
+  }
+
+public:
+  // Proyecta el archivo en memoria y lo parsea con from_chars: ninguna
+  // reserva por linea, solo el crecimiento de los arreglos de la malla.
+  // Los archivos grandes se cortan en limites de linea y cada bloque se
+  // parsea en un hilo distinto (threads = 0 usa todos los nucleos).
+  // Con useCache, si existe una cache binaria al dia se proyecta esa en vez
+  // de parsear, y tras parsear se escribe una nueva.
+  static bool load(const std::string &filename, Mesh &mesh, int threads = 0,
+                   bool useCache = true) {
+    if (useCache && MeshCache::load(filename, mesh)) {
+      std::cout << "Modelo cargado (cache): " << mesh.vertices.size()
+                << " vertices, " << mesh.faces.size() << " caras.\n";
+      return true;
+    }
+
+    MappedFile file;
+    if (!file.open(filename)) {
+      std::cerr << "Error: No se pudo abrir " << filename << std::endl;
+      return false;
+    }
+
+    ThreadPool pool(threads);
+    const char *begin = file.data(), *end = begin + file.size();
+    size_t parts = std::max<size_t>(
+        1, std::min<size_t>(pool.size(), file.size() / MIN_CHUNK_BYTES));
+
+    // Cortes en el primer salto de linea tras cada fraccion del archivo
+    std::vector<const char *> cuts(parts + 1, end);
+    cuts[0] = begin;
+    for (size_t k = 1; k < parts; k++) {
+      const char *p = std::max(begin + file.size() * k / parts, cuts[k - 1]);
+      const char *nl = (const char *)std::memchr(p, '\n', (size_t)(end - p));
+      cuts[k] = nl ? nl + 1 : end;
+    }
+
+    std::vector<ObjChunk> chunks(parts);
+    pool.parallelFor((int)parts, [&](int k) {
+      parseRange(cuts[k], cuts[k + 1], chunks[k]);
+    });
+
+    std::vector<Vec3> normals;
+    std::vector<int> corners;
+    merge(chunks, pool, mesh, normals, corners);
+    resolveNormals(mesh, normals, corners);
+    mesh.computeBounds();
+    mesh.buildClusters();
+    mesh.storage.reset();
+    if (useCache && !MeshCache::save(filename, mesh))
+      std::cerr << "Aviso: no se pudo escribir la cache de " << filename
+                << std::endl;
 
     std::cout << "Modelo cargado: " << mesh.vertices.size() << " vertices, "
               << mesh.faces.size() << " caras.\n";
@@ -0,0 +1,67 @@
+#ifndef PRESENTTHREAD_H
+#define PRESENTTHREAD_H
+
+#include "../Core/SpscRing.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Hilo de presentacion con N buffers de color. El hilo de render toma un
+// buffer libre, dibuja en el y lo envia; este hilo lo entrega (subida de
+// textura, sink...) y lo devuelve, asi el frame N+1 se rasteriza mientras se
+// presenta el N. Los buffers viajan por colas sin bloqueos; el mutex solo
+// sirve para dormir cuando no hay nada que hacer.
+class PresentThread {
+public:
+  static constexpr int MAX_BUFFERS = 8;
+
+  struct Hooks {
+    std::function<bool()> setup; // En el hilo nuevo antes del primer frame
+    std::function<bool(const uint32_t *pixels, int frame)> deliver;
+    std::function<void()> teardown; // En el hilo, al terminar
+  };
+
+  PresentThread() = default;
+  ~PresentThread() { stop(); }
+
+  PresentThread(const PresentThread &) = delete;
+  PresentThread &operator=(const PresentThread &) = delete;
+
+  // Reserva los buffers y arranca el hilo. Devuelve false si setup falla.
+  bool start(int buffers, size_t pixels, Hooks hooks);
+  // Entrega lo pendiente y detiene el hilo
+  void stop();
+  bool running() const { return worker.joinable(); }
+
+  // Buffer libre para el frame siguiente; espera si todos estan en vuelo
+  uint32_t *acquire();
+  // Envia el buffer adquirido para que se presente como 'frame'
+  void submit(int frame);
+  // Alguna entrega fallo (p. ej. sink sin espacio)
+  bool failed() const { return deliverFailed.load(); }
+
+private:
+  struct Slot {
+    int buffer, frame;
+  };
+
+  void loop();
+
+  Hooks hooks;
+  std::vector<std::vector<uint32_t>> buffers;
+  SpscRing<int, MAX_BUFFERS> freeBuffers; // Hilo de presentacion -> render
+  SpscRing<Slot, MAX_BUFFERS> readyFrames; // Render -> presentacion
+  int current = -1;
+
+  std::thread worker;
+  std::mutex mtx;
+  std::condition_variable cvReady, cvFree;
+  bool quit = false;
+  std::atomic<bool> deliverFailed{false};
+};
+
+#endif
@@ -0,0 +1,375 @@
+#ifndef RASTERKERNELS_H
+#define RASTERKERNELS_H
+
+#include <SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define RASTER_X86 1
+#include <immintrin.h>
+#endif
+
+// En GCC/Clang cada kernel se compila para su set de instrucciones y se elige
+// en tiempo de ejecucion; MSVC no necesita el atributo.
+#if defined(RASTER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define RASTER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define RASTER_TARGET(isa)
+#endif
+
+// Curva de sombreado (ambiente + (1 - ambiente) * intensidad^potencia)
+// precalculada: la intensidad cuantizada da un factor en punto fijo 8.8
+// (256 = 1.0). Se reconstruye solo si cambian los parametros, asi que por
+// pixel no hay pow ni aritmetica de color en float.
+struct ShadingLUT {
+  static constexpr int SIZE = 1024;
+  alignas(32) int32_t scale[SIZE + 1];
+  float ambient = -1.0f, power = -1.0f;
+
+  void update(float amb, float pw) {
+    if (amb == ambient && pw == power)
+      return;
+    ambient = amb;
+    power = pw;
+    for (int i = 0; i <= SIZE; i++) {
+      float k = amb + (1.0f - amb) * std::pow((float)i / SIZE, pw);
+      scale[i] = (int32_t)std::lround(std::max(0.0f, std::min(1.0f, k)) * 256);
+    }
+  }
+
+  // Misma secuencia de operaciones que los kernels SIMD
+  int32_t lookup(float intensity) const {
+    float c = std::max(0.0f, std::min(1.0f, intensity));
+    return scale[(int)(c * SIZE + 0.5f)];
+  }
+};
+
+// Escala R, G y B de un pixel ARGB por k (8.8, k <= 256) con una sola
+// multiplicacion: cada canal ocupa un carril de 16 bits de un entero de 64
+// y como canal * k < 65536 no hay acarreo entre carriles. Base del
+// sombreado y de cualquier mezcla (a * (256 - t) + b * t por carriles).
+inline uint32_t modulateColor(uint32_t color, uint32_t k) {
+  uint64_t lanes = ((uint64_t)(color & 0xFF0000) << 16) |
+                   ((color & 0xFF00) << 8) | (color & 0xFF);
+  lanes = ((lanes * k) >> 8) & 0x000000FF00FF00FFull;
+  return 0xFF000000 | ((uint32_t)(lanes >> 16) & 0xFF0000) |
+         ((uint32_t)(lanes >> 8) & 0xFF00) | ((uint32_t)lanes & 0xFF);
+}
+
+inline uint32_t shadeColor(uint32_t color, float intensity,
+                           const ShadingLUT &lut) {
+  return modulateColor(color, (uint32_t)lut.lookup(intensity));
+}
+
+// Etapa de pixel comun: prueba de profundidad -> sombreado -> escritura.
+// 'shade' devuelve el color final y solo se evalua si el pixel es visible,
+// asi que los pixeles tapados no pagan el sombreado (ni el de texturas o
+// iluminacion que se enganche aqui en el futuro).
+template <typename Shade>
+inline bool depthShadeWrite(float z, float &depth, uint32_t &color,
+                            bool depthTest, Shade &&shade) {
+  if (depthTest && !(z < depth - 0.001f))
+    return false;
+  color = shade();
+  depth = z;
+  return true;
+}
+
+// Pasadas del Z-prepass: primero solo la profundidad y despues el color
+// donde el z del triangulo coincide exactamente con el del z-buffer. Todos
+// los kernels calculan z con las mismas operaciones, asi que cada pixel se
+// sombrea una sola vez.
+enum class SpanPass : uint8_t {
+  Full,       // Prueba, sombreado y escritura de color y z
+  DepthOnly,  // Prueba y escritura de z
+  DepthEqual, // Sombreado donde z == z-buffer, sin escribir z
+};
+
+// Constantes por triangulo que comparten todos los kernels de span
+struct SpanSetup {
+  int32_t a0, a1, a2;    // Paso de cada funcion de arista por columna
+  int64_t bias1, bias2;  // Sesgo top-left de w1/w2 (0 o -1)
+  float z1, dz1, dz2;    // Profundidad = z1 + w1 * dz1 + w2 * dz2
+  float i1, di1, di2;    // Intensidad con el mismo esquema
+  uint32_t color;
+  bool shade;
+  const ShadingLUT *lut;
+  bool depthTest; // false: aceptacion trivial, todo pixel cubierto pasa
+  SpanPass pass;
+};
+
+// Rasteriza 'count' pixeles de una fila. w0/w1/w2 son las funciones de
+// arista (ya sesgadas) en el primer pixel del span.
+using SpanKernel = void (*)(const SpanSetup &s, int64_t w0, int64_t w1,
+                            int64_t w2, int count, uint32_t *color,
+                            float *depth);
+
+inline void spanScalar(const SpanSetup &s, int64_t w0, int64_t w1, int64_t w2,
+                       int count, uint32_t *color, float *depth) {
+  for (int x = 0; x < count; x++) {
+    if ((w0 | w1 | w2) >= 0) {
+      float fw1 = (float)(w1 - s.bias1), fw2 = (float)(w2 - s.bias2);
+      float z = s.z1 + fw1 * s.dz1 + fw2 * s.dz2;
+      auto shade = [&] {
+        if (!s.shade)
+          return s.color;
+        float intensity = s.i1 + fw1 * s.di1 + fw2 * s.di2;
+        return shadeColor(s.color, intensity, *s.lut);
+      };
+      if (s.pass == SpanPass::Full)
+        depthShadeWrite(z, depth[x], color[x], s.depthTest, shade);
+      else if (s.pass == SpanPass::DepthEqual) {
+        if (z == depth[x])
+          color[x] = shade();
+      } else if (!s.depthTest || z < depth[x] - 0.001f)
+        depth[x] = z;
+    }
+    w0 += s.a0;
+    w1 += s.a1;
+    w2 += s.a2;
+  }
+}
+
+#ifdef RASTER_X86
+
+// modulateColor para 4 pixeles: 'px16' trae los canales en carriles de 16
+// bits (como _mm_unpacklo_epi8) y 'k' un factor por pixel en 32 bits. Un
+// PMULLW escala todos los canales de dos pixeles; alfa queda en 0.
+RASTER_TARGET("sse2")
+inline __m128i modulateSSE2(__m128i px16, __m128i k) {
+  k = _mm_or_si128(k, _mm_slli_epi32(k, 16)); // k en ambas mitades
+  __m128i lo = _mm_mullo_epi16(px16, _mm_unpacklo_epi32(k, k));
+  __m128i hi = _mm_mullo_epi16(px16, _mm_unpackhi_epi32(k, k));
+  __m128i out = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+  return _mm_and_si128(out, _mm_set1_epi32(0x00FFFFFF));
+}
+
+// Kernel SSE2: 4 pixeles por iteracion, mezcla con and/andnot/or
+RASTER_TARGET("sse2")
+inline void spanSSE2(const SpanSetup &s, int64_t w0, int64_t w1, int64_t w2,
+                     int count, uint32_t *color, float *depth) {
+  int32_t e0 = (int32_t)w0, e1 = (int32_t)w1, e2 = (int32_t)w2;
+  __m128i vw0 = _mm_setr_epi32(e0, e0 + s.a0, e0 + 2 * s.a0, e0 + 3 * s.a0);
+  __m128i vw1 = _mm_setr_epi32(e1, e1 + s.a1, e1 + 2 * s.a1, e1 + 3 * s.a1);
+  __m128i vw2 = _mm_setr_epi32(e2, e2 + s.a2, e2 + 2 * s.a2, e2 + 3 * s.a2);
+  const __m128i step0 = _mm_set1_epi32(4 * s.a0);
+  const __m128i step1 = _mm_set1_epi32(4 * s.a1);
+  const __m128i step2 = _mm_set1_epi32(4 * s.a2);
+  const __m128i minusOne = _mm_set1_epi32(-1);
+  const __m128i bias1 = _mm_set1_epi32((int32_t)s.bias1);
+  const __m128i bias2 = _mm_set1_epi32((int32_t)s.bias2);
+  const __m128 z1 = _mm_set1_ps(s.z1), dz1 = _mm_set1_ps(s.dz1),
+               dz2 = _mm_set1_ps(s.dz2);
+  const __m128 i1 = _mm_set1_ps(s.i1), di1 = _mm_set1_ps(s.di1),
+               di2 = _mm_set1_ps(s.di2);
+  const __m128 eps = _mm_set1_ps(0.001f);
+  const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+  const __m128 lutSize = _mm_set1_ps((float)ShadingLUT::SIZE),
+               half = _mm_set1_ps(0.5f);
+  const __m128i alpha = _mm_set1_epi32((int32_t)0xFF000000);
+  const __m128i flat = _mm_set1_epi32((int32_t)s.color);
+  // Canales del color en carriles de 16 bits (dos pixeles por registro)
+  const __m128i flat16 = _mm_unpacklo_epi8(flat, _mm_setzero_si128());
+
+  int x = 0;
+  for (; x + 4 <= count; x += 4) {
+    __m128i inside = _mm_cmpgt_epi32(
+        _mm_or_si128(_mm_or_si128(vw0, vw1), vw2), minusOne);
+    if (_mm_movemask_epi8(inside)) {
+      __m128 fw1 = _mm_cvtepi32_ps(_mm_sub_epi32(vw1, bias1));
+      __m128 fw2 = _mm_cvtepi32_ps(_mm_sub_epi32(vw2, bias2));
+      __m128 z = _mm_add_ps(_mm_add_ps(z1, _mm_mul_ps(fw1, dz1)),
+                            _mm_mul_ps(fw2, dz2));
+      __m128 pass = _mm_castsi128_ps(inside);
+      if (s.pass == SpanPass::DepthEqual)
+        pass = _mm_and_ps(pass, _mm_cmpeq_ps(z, _mm_loadu_ps(depth + x)));
+      else if (s.depthTest)
+        pass = _mm_and_ps(
+            pass, _mm_cmplt_ps(z, _mm_sub_ps(_mm_loadu_ps(depth + x), eps)));
+      int bits = _mm_movemask_ps(pass);
+      bool all = bits == 0xF; // Todos pasan: sin leer lo anterior
+      if (bits && s.pass != SpanPass::DepthOnly) {
+        __m128i shaded = flat;
+        if (s.shade) {
+          __m128 in = _mm_add_ps(_mm_add_ps(i1, _mm_mul_ps(fw1, di1)),
+                                 _mm_mul_ps(fw2, di2));
+          in = _mm_min_ps(_mm_max_ps(in, zero), one);
+          alignas(16) int32_t idx[4];
+          _mm_store_si128((__m128i *)idx, _mm_cvttps_epi32(_mm_add_ps(
+                                              _mm_mul_ps(in, lutSize), half)));
+          const int32_t *lut = s.lut->scale;
+          __m128i k = _mm_setr_epi32(lut[idx[0]], lut[idx[1]], lut[idx[2]],
+                                     lut[idx[3]]);
+          shaded = _mm_or_si128(alpha, modulateSSE2(flat16, k));
+        }
+        if (all) {
+          _mm_storeu_si128((__m128i *)(color + x), shaded);
+        } else {
+          __m128i mask = _mm_castps_si128(pass);
+          __m128i old = _mm_loadu_si128((const __m128i *)(color + x));
+          _mm_storeu_si128((__m128i *)(color + x),
+                           _mm_or_si128(_mm_and_si128(mask, shaded),
+                                        _mm_andnot_si128(mask, old)));
+        }
+      }
+      if (bits && s.pass != SpanPass::DepthEqual) {
+        if (all) {
+          _mm_storeu_ps(depth + x, z);
+        } else {
+          __m128 zb = _mm_loadu_ps(depth + x);
+          _mm_storeu_ps(depth + x, _mm_or_ps(_mm_and_ps(pass, z),
+                                             _mm_andnot_ps(pass, zb)));
+        }
+      }
+    }
+    vw0 = _mm_add_epi32(vw0, step0);
+    vw1 = _mm_add_epi32(vw1, step1);
+    vw2 = _mm_add_epi32(vw2, step2);
+  }
+  if (x < count)
+    spanScalar(s, w0 + (int64_t)s.a0 * x, w1 + (int64_t)s.a1 * x,
+               w2 + (int64_t)s.a2 * x, count - x, color + x, depth + x);
+}
+
+// Igual que modulateSSE2 con 8 pixeles; los unpack y el pack trabajan por
+// mitades de 128 bits, asi que el orden de los pixeles se conserva
+RASTER_TARGET("avx2")
+inline __m256i modulateAVX2(__m256i px16, __m256i k) {
+  k = _mm256_or_si256(k, _mm256_slli_epi32(k, 16));
+  __m256i lo = _mm256_mullo_epi16(px16, _mm256_unpacklo_epi32(k, k));
+  __m256i hi = _mm256_mullo_epi16(px16, _mm256_unpackhi_epi32(k, k));
+  __m256i out = _mm256_packus_epi16(_mm256_srli_epi16(lo, 8),
+                                    _mm256_srli_epi16(hi, 8));
+  return _mm256_and_si256(out, _mm256_set1_epi32(0x00FFFFFF));
+}
+
+// Kernel AVX2: 8 pixeles por iteracion con mezcla por blendv
+RASTER_TARGET("avx2")
+inline void spanAVX2(const SpanSetup &s, int64_t w0, int64_t w1, int64_t w2,
+                     int count, uint32_t *color, float *depth) {
+  const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i vw0 = _mm256_add_epi32(
+      _mm256_set1_epi32((int32_t)w0),
+      _mm256_mullo_epi32(lane, _mm256_set1_epi32(s.a0)));
+  __m256i vw1 = _mm256_add_epi32(
+      _mm256_set1_epi32((int32_t)w1),
+      _mm256_mullo_epi32(lane, _mm256_set1_epi32(s.a1)));
+  __m256i vw2 = _mm256_add_epi32(
+      _mm256_set1_epi32((int32_t)w2),
+      _mm256_mullo_epi32(lane, _mm256_set1_epi32(s.a2)));
+  const __m256i step0 = _mm256_set1_epi32(8 * s.a0);
+  const __m256i step1 = _mm256_set1_epi32(8 * s.a1);
+  const __m256i step2 = _mm256_set1_epi32(8 * s.a2);
+  const __m256i minusOne = _mm256_set1_epi32(-1);
+  const __m256i bias1 = _mm256_set1_epi32((int32_t)s.bias1);
+  const __m256i bias2 = _mm256_set1_epi32((int32_t)s.bias2);
+  const __m256 z1 = _mm256_set1_ps(s.z1), dz1 = _mm256_set1_ps(s.dz1),
+               dz2 = _mm256_set1_ps(s.dz2);
+  const __m256 i1 = _mm256_set1_ps(s.i1), di1 = _mm256_set1_ps(s.di1),
+               di2 = _mm256_set1_ps(s.di2);
+  const __m256 eps = _mm256_set1_ps(0.001f);
+  const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+  const __m256 lutSize = _mm256_set1_ps((float)ShadingLUT::SIZE),
+               half = _mm256_set1_ps(0.5f);
+  const __m256i alpha = _mm256_set1_epi32((int32_t)0xFF000000);
+  const __m256i flat = _mm256_set1_epi32((int32_t)s.color);
+  const __m256i flat16 = _mm256_unpacklo_epi8(flat, _mm256_setzero_si256());
+
+  int x = 0;
+  for (; x + 8 <= count; x += 8) {
+    __m256i inside = _mm256_cmpgt_epi32(
+        _mm256_or_si256(_mm256_or_si256(vw0, vw1), vw2), minusOne);
+    if (!_mm256_testz_si256(inside, inside)) {
+      __m256 fw1 = _mm256_cvtepi32_ps(_mm256_sub_epi32(vw1, bias1));
+      __m256 fw2 = _mm256_cvtepi32_ps(_mm256_sub_epi32(vw2, bias2));
+      __m256 z = _mm256_add_ps(_mm256_add_ps(z1, _mm256_mul_ps(fw1, dz1)),
+                               _mm256_mul_ps(fw2, dz2));
+      __m256 pass = _mm256_castsi256_ps(inside);
+      if (s.pass == SpanPass::DepthEqual) {
+        __m256 zb = _mm256_loadu_ps(depth + x);
+        pass = _mm256_and_ps(pass, _mm256_cmp_ps(z, zb, _CMP_EQ_OQ));
+      } else if (s.depthTest) {
+        __m256 limit = _mm256_sub_ps(_mm256_loadu_ps(depth + x), eps);
+        pass = _mm256_and_ps(pass, _mm256_cmp_ps(z, limit, _CMP_LT_OQ));
+      }
+      int bits = _mm256_movemask_ps(pass);
+      bool all = bits == 0xFF; // Todos pasan: sin leer lo anterior
+      if (bits && s.pass != SpanPass::DepthOnly) {
+        __m256i shaded = flat;
+        if (s.shade) {
+          __m256 in = _mm256_add_ps(_mm256_add_ps(i1, _mm256_mul_ps(fw1, di1)),
+                                    _mm256_mul_ps(fw2, di2));
+          in = _mm256_min_ps(_mm256_max_ps(in, zero), one);
+          __m256i idx = _mm256_cvttps_epi32(
+              _mm256_add_ps(_mm256_mul_ps(in, lutSize), half));
+          __m256i k = _mm256_i32gather_epi32(s.lut->scale, idx, 4);
+          shaded = _mm256_or_si256(alpha, modulateAVX2(flat16, k));
+        }
+        if (all) {
+          _mm256_storeu_si256((__m256i *)(color + x), shaded);
+        } else {
+          __m256i old = _mm256_loadu_si256((const __m256i *)(color + x));
+          _mm256_storeu_si256(
+              (__m256i *)(color + x),
+              _mm256_blendv_epi8(old, shaded, _mm256_castps_si256(pass)));
+        }
+      }
+      if (bits && s.pass != SpanPass::DepthEqual) {
+        if (all) {
+          _mm256_storeu_ps(depth + x, z);
+        } else {
+          __m256 zb = _mm256_loadu_ps(depth + x);
+          _mm256_storeu_ps(depth + x, _mm256_blendv_ps(zb, z, pass));
+        }
+      }
+    }
+    vw0 = _mm256_add_epi32(vw0, step0);
+    vw1 = _mm256_add_epi32(vw1, step1);
+    vw2 = _mm256_add_epi32(vw2, step2);
+  }
+  if (x < count)
+    spanScalar(s, w0 + (int64_t)s.a0 * x, w1 + (int64_t)s.a1 * x,
+               w2 + (int64_t)s.a2 * x, count - x, color + x, depth + x);
+}
+
+#endif
+
+// Profundidad maxima de un rectangulo del z-buffer (para el Z jerarquico)
+inline float depthMax(const float *depth, int stride, int w, int h) {
+  float m = depth[0];
+#ifdef RASTER_X86
+  __m128 vm = _mm_set1_ps(m);
+  for (int y = 0; y < h; y++) {
+    const float *row = depth + (size_t)stride * y;
+    int x = 0;
+    for (; x + 4 <= w; x += 4)
+      vm = _mm_max_ps(vm, _mm_loadu_ps(row + x));
+    for (; x < w; x++)
+      m = std::max(m, row[x]);
+  }
+  alignas(16) float lanes[4];
+  _mm_store_ps(lanes, vm);
+  for (float v : lanes)
+    m = std::max(m, v);
+#else
+  for (int y = 0; y < h; y++)
+    for (int x = 0; x < w; x++)
+      m = std::max(m, depth[(size_t)stride * y + x]);
+#endif
+  return m;
+}
+
+// Elige el kernel mas ancho que soporte la CPU
+inline SpanKernel selectSpanKernel() {
+#ifdef RASTER_X86
+  if (SDL_HasAVX2())
+    return spanAVX2;
+  if (SDL_HasSSE2())
+    return spanSSE2;
+#endif
+  return spanScalar;
+}
+
+#endif
@@ -1,13 +1,23 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include "../Core/ThreadPool.h"
 #include "../Graphics/Mesh.h"
+#include "../Math/Mat4.h"
 #include "../Math/Vec2.h"
 #include "../Math/Vec3.h"
+#include "../Math/Vec4.h"
+#include "Clipping.h"
+#include "FrameSink.h"
+#include "PresentThread.h"
+#include "RasterKernels.h"
+#include "VertexKernels.h"
 #include <SDL.h>
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
+#include <utility>
 #include <vector>
 
 class Renderer {
@@ -18,8 +28,101 @@ private:
   uint32_t *color_buffer;
   float *z_buffer;
   SDL_Texture *color_buffer_texture;
+  // Destino de color del frame en curso: la textura bloqueada (sin copia al
+  // presentar) o color_buffer. color_pitch se mide en pixeles.
+  uint32_t *color_target = nullptr;
+  int color_pitch = 0;
+  bool frameStarted = false;
+  bool textureLocked = false;
+  // Con mas de un buffer, los frames se presentan en un hilo aparte y
+  // color_buffer es el buffer que presenter presto para el frame en curso
+  PresentThread presenter;
+  bool asyncPresent = false;
+  bool headless = false; // Sin ventana: los frames van a frameSink
+  FrameSink frameSink;
+  int frameIndex = 0;
 
   float fov_factor = 600.0f;
+  float ortho_scale = 200.0f;
+  float nearPlane = 0.1f, farPlane = 1000.0f; // En z de vista
+  // Camara: la escena queda 5 unidades al frente
+  Mat4 view = Mat4::translation(0, 0, 5.0f);
+  float ambient = 0.05f;
+  float shadingPower = 3.0f;
+  ShadingLUT shadingLut; // Curva de sombreado precalculada
+  SpanKernel simdKernel;           // Kernel elegido segun la CPU
+  TransformKernel transformKernel; // Etapa de vertices (AVX o escalar)
+  TransformedVertices xf;          // Salida de la etapa, reutilizada
+  Vec3Array fallbackNormals;       // Para mallas cargadas sin normales
+
+  // Rangos [begin, end) de caras y de vertices que sobreviven al descarte
+  // por clusters, reutilizados entre mallas
+  struct IndexSpan {
+    size_t begin, end;
+  };
+  std::vector<IndexSpan> faceSpans, vertexSpans, vertexChunks;
+
+  // Primitiva ya proyectada, pendiente de rasterizar en flush()
+  struct RasterCmd {
+    enum Type : uint8_t { Triangle, Line, Point } type;
+    int x[3], y[3];
+    float z[3], i[3];
+    uint32_t color;
+  };
+
+  // Rectangulo de recorte inclusivo (pantalla completa o un tile)
+  struct ClipRect {
+    int x0, y0, x1, y1;
+  };
+
+  // Memoria de trabajo persistente: solo crece cuando una escena supera el
+  // maximo anterior, asi que los frames estables no reservan nada.
+  static constexpr int TILE_SIZE = 64;
+  int tilesX, tilesY;
+  std::vector<RasterCmd> commands;
+  std::vector<uint32_t> binStart;  // Inicio de cada tile en binItems (+1)
+  std::vector<uint32_t> binCursor; // Posicion de escritura al repartir
+  std::vector<uint32_t> binItems;  // Indices de commands agrupados por tile
+
+  // Orden de dibujo de adelante hacia atras por grupos de SORT_GROUP
+  // comandos consecutivos (caras vecinas en la malla), segun la z mas
+  // cercana del grupo cuantizada a 16 bits. Ordenar grupos y no comandos
+  // sueltos mantiene la localidad al repartir en tiles. groupOrder se
+  // conserva entre frames: si la camara apenas se movio basta reordenarlo
+  // por insercion; si no, radix. drawOrder es el orden ya expandido.
+  static constexpr uint32_t SORT_GROUP = 64;
+  std::vector<uint32_t> drawOrder, groupOrder, sortScratch;
+  std::vector<float> sortDepth;
+  std::vector<uint16_t> sortKeys;
+
+  // Borrado diferido del z-buffer: clear() solo avanza la generacion y cada
+  // tile se rellena al usarlo, ya en cache y en el hilo que lo rasteriza. Un
+  // tile sin primitivas ni se toca.
+  uint32_t depthGen = 0;
+  std::vector<uint32_t> tileDepthGen;
+  bool depthPending = false;
+
+  // Z jerarquico: cotas conservadoras de la profundidad de cada tile. maxZ
+  // solo baja cuando un triangulo cubre el tile entero; minZ baja con cada
+  // escritura. Lo dibujado fuera de los tiles invalida minZ hasta el
+  // proximo borrado (maxZ sigue valiendo: la profundidad nunca sube).
+  struct TileDepth {
+    float minZ, maxZ;
+  };
+  std::vector<TileDepth> tileZ;
+  bool tileMinValid = true;
+
+  // Buffer de visibilidad: por pixel, 1 + indice en commands del triangulo
+  // visible (0 = nada de este flush). visTris guarda por triangulo lo que
+  // el pase de sombreado necesita para reconstruir sus baricentricas.
+  struct VisTriangle {
+    int x1, y1, x2, y2, x3, y3; // En el orden de area positiva
+    float i1, di1, di2;
+    uint32_t color;
+  };
+  std::vector<uint32_t> visBuffer;
+  std::vector<VisTriangle> visTris;
+  ThreadPool pool;
 
 public:
   bool renderTriangles = true;
@@ -28,6 +131,17 @@ public:
   bool renderBackface = false;
   bool isPerspective = true;
   bool useShading = true;
+  bool zPrepass = false; // Profundidad primero, luego una sombra por pixel
+  bool visibility = false; // Buffer de visibilidad y sombreado diferido
+  bool useEdgeRaster = true; // Rasterizador por funciones de arista
+  bool useSimd = true;       // Kernel SSE2/AVX2 si la CPU lo soporta
+  bool useTiles = true;      // Rasterizado por tiles en varios hilos
+  bool directPresent = true; // Rasterizar directo en la textura bloqueada
+  bool lazyClear = true;     // Borrar el z de cada tile al usarlo
+  bool useHiZ = true;        // Descartar/aceptar triangulos por tile
+  bool depthSort = true;     // Dibujar de adelante hacia atras
+  bool frustumCull = true;   // Descartar mallas/clusters fuera de la vista
+  bool coneCull = true;      // Descartar clusters de espaldas a la camara
 
   void toggleTriangles() { renderTriangles = !renderTriangles; }
   void toggleLines() { renderLines = !renderLines; }
@@ -35,20 +149,32 @@ public:
   void toggleCulling() { renderBackface = !renderBackface; }
   void togglePerspective() { isPerspective = !isPerspective; }
   void toggleShading() { useShading = !useShading; }
+  void toggleZPrepass() { zPrepass = !zPrepass; }
+  void toggleVisibility() { visibility = !visibility; }
+  void toggleRasterizer() { useEdgeRaster = !useEdgeRaster; }
+  void toggleSimd() { useSimd = !useSimd; }
+  void toggleTiles() { useTiles = !useTiles; }
+  void toggleDirectPresent() { directPresent = !directPresent; }
+  void toggleLazyClear() { lazyClear = !lazyClear; }
+  void toggleHiZ() { useHiZ = !useHiZ; }
+  void toggleDepthSort() { depthSort = !depthSort; }
+  void toggleFrustumCull() { frustumCull = !frustumCull; }
+  void toggleConeCull() { coneCull = !coneCull; }
+
+  void setView(const Mat4 &m) { view = m; }
+  // Luz ambiente y exponente de la curva de sombreado. La tabla solo se
+  // recalcula si alguno cambia.
+  void setShadingCurve(float amb, float power) {
+    ambient = amb;
+    shadingPower = power;
+    shadingLut.update(ambient, shadingPower);
+  }
 
 private:
-  Vec2 project(Vec3 v) {
-    if (isPerspective) {
-      float z = std::max(0.1f, v.z);
-      // En SDL +Y es abajo, multiplicamos math-y por -1 para que el cubo rote
-      // "hacia arriba" correctamente o simplemente dejamos que el sistema de
-      // coordenadas sea el que es.
-      return {(v.x * fov_factor) / z + width / 2.0f,
-              (v.y * fov_factor) / z + height / 2.0f};
-    } else {
-      float scale = 200.0f;
-      return {v.x * scale + width / 2.0f, v.y * scale + height / 2.0f};
-    }
+  // Proyeccion a pixeles relativos al centro de la pantalla
+  Mat4 projection() const {
+    return isPerspective ? Mat4::perspective(fov_factor)
+                         : Mat4::orthographic(ortho_scale);
   }
 
   uint32_t applyShading(uint32_t color, float intensity) {
@@ -56,89 +182,605 @@ private:
       return color;
 
     // Curva premium: Sombreado más profundo y progresivo
-    float ambient = 0.05f;
-    float power = 3.0f;
-    float k = ambient +
-              (1.0f - ambient) *
-                  std::pow(std::max(0.0f, std::min(1.0f, intensity)), power);
-
-    uint8_t r = (uint8_t)(((color >> 16) & 0xFF) * k);
-    uint8_t g = (uint8_t)(((color >> 8) & 0xFF) * k);
-    uint8_t b = (uint8_t)((color & 0xFF) * k);
-    return (0xFF000000) | (r << 16) | (g << 8) | b;
+    return shadeColor(color, intensity, shadingLut);
   }
 
   void clearZBuffer() { std::fill_n(z_buffer, width * height, 10000.0f); }
 
-public:
-  Renderer(int w, int h)
-      : width(w), height(h), window(nullptr), renderer(nullptr),
-        color_buffer(nullptr), z_buffer(nullptr) {}
+  ClipRect tileRect(int t) const {
+    int tx = t % tilesX, ty = t / tilesX;
+    return {tx * TILE_SIZE, ty * TILE_SIZE,
+            std::min((tx + 1) * TILE_SIZE, width) - 1,
+            std::min((ty + 1) * TILE_SIZE, height) - 1};
+  }
 
-  bool init() {
-    if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
-      return false;
-    window = SDL_CreateWindow("3D Renderer (C++)", SDL_WINDOWPOS_CENTERED,
-                              SDL_WINDOWPOS_CENTERED, width, height, 0);
-    if (!window)
-      return false;
+  // Borra el z del tile si sigue siendo de un frame anterior
+  void resolveDepth(int t) {
+    if (tileDepthGen[t] == depthGen)
+      return;
+    ClipRect r = tileRect(t);
+    for (int y = r.y0; y <= r.y1; y++)
+      std::fill_n(z_buffer + width * y + r.x0, r.x1 - r.x0 + 1, 10000.0f);
+    tileDepthGen[t] = depthGen;
+    tileZ[t] = {10000.0f, 10000.0f};
+  }
+
+  // Todos los tiles: para el camino serie y el dibujo inmediato
+  void resolveClears() {
+    if (!depthPending)
+      return;
+    pool.parallelFor(tilesX * tilesY, [&](int t) { resolveDepth(t); });
+    depthPending = false;
+  }
+
+  void invalidateDepth() {
+    tileMinValid = true;
+    if (!lazyClear) {
+      clearZBuffer();
+      std::fill(tileDepthGen.begin(), tileDepthGen.end(), depthGen);
+      std::fill(tileZ.begin(), tileZ.end(), TileDepth{10000.0f, 10000.0f});
+      depthPending = false;
+      return;
+    }
+    if (++depthGen == 0) { // Al dar la vuelta se reinician los tiles
+      std::fill(tileDepthGen.begin(), tileDepthGen.end(), 0);
+      depthGen = 1;
+    }
+    depthPending = true;
+  }
+
+  // Elige el destino de color al primer dibujo del frame. La textura
+  // bloqueada es de solo escritura (su contenido previo es indefinido), asi
+  // que el modo directo cuenta con que clear() cubra toda la pantalla.
+  void beginFrame() {
+    if (frameStarted)
+      return;
+    frameStarted = true;
+    if (asyncPresent)
+      color_buffer = presenter.acquire();
+    color_target = color_buffer;
+    color_pitch = width;
+    // En modo asincrono la textura pertenece al hilo de presentacion
+    if (asyncPresent || !directPresent || !color_buffer_texture)
+      return;
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(color_buffer_texture, NULL, &pixels, &pitch) != 0)
+      return;
+    textureLocked = true;
+    if (pitch % (int)sizeof(uint32_t) != 0) {
+      SDL_UnlockTexture(color_buffer_texture); // Pitch inusable: copia
+      textureLocked = false;
+      return;
+    }
+    color_target = (uint32_t *)pixels;
+    color_pitch = pitch / (int)sizeof(uint32_t);
+  }
+
+  bool createRenderTarget() {
     renderer = SDL_CreateRenderer(window, -1, 0);
     if (!renderer)
       return false;
-
-    color_buffer = new uint32_t[width * height];
-    z_buffer = new float[width * height];
     color_buffer_texture =
         SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
                           SDL_TEXTUREACCESS_STREAMING, width, height);
-    return true;
+    return color_buffer_texture != nullptr;
   }
 
-  void clear(uint32_t color) {
-    std::fill_n(color_buffer, width * height, color);
-    clearZBuffer();
+  void destroyRenderTarget() {
+    if (color_buffer_texture)
+      SDL_DestroyTexture(color_buffer_texture);
+    if (renderer)
+      SDL_DestroyRenderer(renderer);
+    color_buffer_texture = nullptr;
+    renderer = nullptr;
   }
 
-  void drawPixel(int x, int y, float z, uint32_t color) {
-    if (x >= 0 && x < width && y >= 0 && y < height) {
-      int idx = width * y + x;
-      // Precision check: Usar un pequeño margen para Z-fighting
-      if (z < z_buffer[idx] - 0.001f) {
-        color_buffer[idx] = color;
-        z_buffer[idx] = z;
-      }
-    }
+  void showTexture() {
+    SDL_RenderCopy(renderer, color_buffer_texture, NULL, NULL);
+    SDL_RenderPresent(renderer);
   }
 
-  void drawLine(int x0, int y0, float z0, int x1, int y1, float z1,
-                uint32_t color) {
+  // Etapa de pixel sobre los buffers del frame, sin recorte: prueba de
+  // profundidad (con un pequeño margen para Z-fighting), luego 'shade'
+  template <typename Shade>
+  void shadePixel(int x, int y, float z, Shade &&shade) {
+    depthShadeWrite(z, z_buffer[width * y + x],
+                    color_target[color_pitch * y + x], true, shade);
+  }
+
+  void plotPixel(int x, int y, float z, uint32_t color) {
+    shadePixel(x, y, z, [color] { return color; });
+  }
+
+  // Funcion de arista: > 0 si p queda a la izquierda de a->b (Y hacia abajo)
+  static int64_t edgeFunction(int ax, int ay, int bx, int by, int px, int py) {
+    return (int64_t)(bx - ax) * (py - ay) - (int64_t)(by - ay) * (px - ax);
+  }
+
+  // Regla top-left: los pixeles sobre aristas compartidas se dibujan una vez
+  static bool isTopLeft(int ax, int ay, int bx, int by) {
+    return (by < ay) || (by == ay && bx > ax);
+  }
+
+  ClipRect screenRect() const { return {0, 0, width - 1, height - 1}; }
+
+  void plotClipped(int x, int y, float z, uint32_t color, const ClipRect &r) {
+    if (x >= r.x0 && x <= r.x1 && y >= r.y0 && y <= r.y1)
+      plotPixel(x, y, z, color);
+  }
+
+  // Pasos [a, b] de un eje de Bresenham cuya coordenada c0 + s * n cae
+  // dentro de [lo, hi]
+  static void axisSpan(int c0, int s, int lo, int hi, int64_t &a,
+                       int64_t &b) {
+    a = s > 0 ? (int64_t)lo - c0 : (int64_t)c0 - hi;
+    b = s > 0 ? (int64_t)hi - c0 : (int64_t)c0 - lo;
+  }
+
+  // Bresenham recortado a 'r' de una vez: el eje mayor avanza en cada paso
+  // y tras k pasos el menor lleva (2km + M) / 2M avances, asi que el tramo
+  // visible [k0, k1] y el estado del error en k0 salen sin recorrer lo que
+  // queda fuera. Los pixeles y la profundidad de cada paso son los del
+  // trazo completo, asi que los tiles cosen sin costuras.
+  void drawLineClipped(int x0, int y0, float z0, int x1, int y1, float z1,
+                       uint32_t color, const ClipRect &r) {
     int dx = std::abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
     int dy = -std::abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
-    int err = dx + dy, e2;
+    bool xMajor = dx >= -dy;
+    int64_t M = std::max(dx, -dy), m = std::min(dx, -dy);
+
+    int64_t k0, k1, a, b;
+    if (xMajor) {
+      axisSpan(x0, sx, r.x0, r.x1, k0, k1);
+      axisSpan(y0, sy, r.y0, r.y1, a, b);
+    } else {
+      axisSpan(y0, sy, r.y0, r.y1, k0, k1);
+      axisSpan(x0, sx, r.x0, r.x1, a, b);
+    }
+    k0 = std::max<int64_t>(k0, 0);
+    k1 = std::min(k1, M);
+    if (b < 0 || (m == 0 && a > 0))
+      return;
+    if (m > 0) {
+      if (a > 0)
+        k0 = std::max(k0, ((2 * a - 1) * M + 2 * m - 1) / (2 * m));
+      k1 = std::min(k1, ((2 * b + 1) * M + 2 * m - 1) / (2 * m) - 1);
+    }
+    if (k0 > k1)
+      return;
+
+    int n = M > 0 ? (int)((2 * k0 * m + M) / (2 * M)) : 0;
+    int nx = xMajor ? (int)k0 : n, ny = xMajor ? n : (int)k0;
+    int x = x0 + sx * nx, y = y0 + sy * ny;
+    int err = dx + dy + nx * dy + ny * dx, e2;
     float dist = (float)std::sqrt(dx * dx + dy * dy);
-    int step = 0;
-    while (true) {
+    for (int step = (int)k0; step <= (int)k1; step++) {
       float t = (dist <= 0) ? 0 : (float)step / dist;
       float z = z0 + (z1 - z0) * t;
-      drawPixel(x0, y0, z - 0.1f, color); // Líneas siempre un poco al frente
-      if (x0 == x1 && y0 == y1)
-        break;
+      // Líneas siempre un poco al frente
+      plotPixel(x, y, z - 0.1f, color);
       e2 = 2 * err;
       if (e2 >= dy) {
         err += dy;
-        x0 += sx;
+        x += sx;
       }
       if (e2 <= dx) {
         err += dx;
-        y0 += sy;
+        y += sy;
       }
-      step++;
     }
   }
 
+  // 'pass' solo afecta a los triangulos del rasterizador de aristas
+  void rasterize(const RasterCmd &c, const ClipRect &r,
+                 SpanPass pass = SpanPass::Full, uint32_t visId = 0) {
+    switch (c.type) {
+    case RasterCmd::Triangle:
+      if (useEdgeRaster)
+        rasterTriangleEdge(c, r, true, pass, visId);
+      else
+        fillTriangle(c.x[0], c.y[0], c.z[0], c.i[0], c.x[1], c.y[1], c.z[1],
+                     c.i[1], c.x[2], c.y[2], c.z[2], c.i[2], c.color);
+      break;
+    case RasterCmd::Line:
+      drawLineClipped(c.x[0], c.y[0], c.z[0], c.x[1], c.y[1], c.z[1], c.color,
+                      r);
+      break;
+    case RasterCmd::Point:
+      plotClipped(c.x[0], c.y[0], c.z[0], c.color, r);
+      break;
+    }
+  }
+
+  // Rango de profundidad que puede escribir el comando (lineas y puntos ya
+  // con su desplazamiento hacia la camara)
+  static void commandDepth(const RasterCmd &c, float &lo, float &hi) {
+    lo = hi = c.z[0];
+    if (c.type == RasterCmd::Point)
+      return;
+    int verts = c.type == RasterCmd::Triangle ? 3 : 2;
+    for (int k = 1; k < verts; k++) {
+      lo = std::min(lo, c.z[k]);
+      hi = std::max(hi, c.z[k]);
+    }
+    if (c.type == RasterCmd::Line) {
+      lo -= 0.1f;
+      hi -= 0.1f;
+    }
+  }
+
+  // Rasteriza dentro del tile 't' usando sus cotas de profundidad. Las
+  // pruebas replican la del pixel (z < zbuf - 0.001) con un margen por el
+  // error de interpolar, asi que el resultado es identico sin Z jerarquico.
+  // En la pasada DepthEqual el z-buffer ya es el final: solo se descarta lo
+  // que no puede igualarlo en ningun pixel y las cotas no cambian.
+  void rasterizeHiZ(const RasterCmd &c, const ClipRect &r, TileDepth &tz,
+                    SpanPass pass = SpanPass::Full, uint32_t visId = 0) {
+    float lo, hi;
+    commandDepth(c, lo, hi);
+    float err = 1e-4f * (1.0f + std::max(std::abs(lo), std::abs(hi)));
+    if (c.type != RasterCmd::Triangle) {
+      rasterize(c, r);
+      tz.minZ = std::min(tz.minZ, lo - err);
+      return;
+    }
+    if (pass == SpanPass::DepthEqual) {
+      if (lo - err <= tz.maxZ)
+        rasterTriangleEdge(c, r, true, pass);
+      return;
+    }
+    if (lo - err >= tz.maxZ - 0.001f)
+      return; // Detras de todo lo dibujado en el tile
+    bool accept = tileMinValid && hi + err < tz.minZ - 0.001f;
+    // Si lo cubre entero, ningun pixel queda mas lejos que hi (o que el
+    // valor que ya tenia, si la prueba fallo por el margen de 0.001). Si
+    // solo su caja abarca el tile (p. ej. medio quad) se recalcula el
+    // maximo real, que cuesta menos que lo que se acaba de rasterizar.
+    bool spans = std::min({c.x[0], c.x[1], c.x[2]}) <= r.x0 &&
+                 std::max({c.x[0], c.x[1], c.x[2]}) >= r.x1 &&
+                 std::min({c.y[0], c.y[1], c.y[2]}) <= r.y0 &&
+                 std::max({c.y[0], c.y[1], c.y[2]}) >= r.y1;
+    if (rasterTriangleEdge(c, r, !accept, pass, visId))
+      tz.maxZ = std::min(tz.maxZ, hi + err + 0.001f);
+    else if (spans)
+      tz.maxZ = depthMax(z_buffer + width * r.y0 + r.x0, width,
+                         r.x1 - r.x0 + 1, r.y1 - r.y0 + 1);
+    tz.minZ = std::min(tz.minZ, lo - err);
+  }
+
+  void pushLine(Vec2 p0, float z0, Vec2 p1, float z1) {
+    commands.push_back({RasterCmd::Line,
+                        {(int)p0.x, (int)p1.x, 0},
+                        {(int)p0.y, (int)p1.y, 0},
+                        {z0, z1, 0},
+                        {0, 0, 0},
+                        0xFFFFFFFF});
+  }
+
+  void pushPoint(Vec2 p, float z) {
+    commands.push_back({RasterCmd::Point,
+                        {(int)p.x, 0, 0},
+                        {(int)p.y, 0, 0},
+                        {z - 0.2f, 0, 0},
+                        {0, 0, 0},
+                        0xFFFF0000});
+  }
+
+  // Banda de guarda: coordenadas de pantalla dentro de +-8191 (el rango de
+  // los kernels SIMD), nunca mas angosta que la propia pantalla
+  ClipPlanes clipPlanes() const {
+    float cx = width / 2.0f, cy = height / 2.0f;
+    return {nearPlane, farPlane, std::max(8191.0f - cx, cx),
+            std::max(8191.0f - cy, cy)};
+  }
+
+  // Codigo de recorte de un vertice ya transformado. Detras del plano near
+  // su proyeccion no vale, asi que solo se marca ese plano.
+  uint8_t clipCode(size_t v, const ClipPlanes &p) const {
+    float z = xf.vz[v];
+    if (!(z >= p.nearZ))
+      return CLIP_NEAR;
+    uint8_t code = z > p.farZ ? CLIP_FAR : 0;
+    float dx = xf.sx[v] - width / 2.0f, dy = xf.sy[v] - height / 2.0f;
+    if (dx < -p.guardX)
+      code |= CLIP_LEFT;
+    if (dx > p.guardX)
+      code |= CLIP_RIGHT;
+    if (dy < -p.guardY)
+      code |= CLIP_TOP;
+    if (dy > p.guardY)
+      code |= CLIP_BOTTOM;
+    return code;
+  }
+
+  // Cara que cruza near/far o sale de la banda de guarda: se recorta en
+  // espacio de clip (antes de dividir por w, asi que nada queda detras de
+  // la camara) y el poligono resultante se triangula en abanico. Las lineas
+  // recortan las aristas originales y los puntos fuera se omiten.
+  void emitClipped(const Mat4 &proj, const ClipPlanes &planes,
+                   const Vec3 (&v)[3], const float (&in)[3],
+                   const uint8_t (&codes)[3], uint32_t color) {
+    ClipVertex cv[3];
+    for (int k = 0; k < 3; k++) {
+      Vec4 p = proj * Vec4(v[k], 1.0f);
+      cv[k] = {p.x, p.y, v[k].z, p.w, in[k]};
+    }
+    float cx = width / 2.0f, cy = height / 2.0f;
+    auto screen = [&](const ClipVertex &p) {
+      return Vec2{p.x / p.w + cx, p.y / p.w + cy};
+    };
+
+    if (renderTriangles) {
+      ClipVertex poly[CLIP_MAX_VERTICES] = {cv[0], cv[1], cv[2]};
+      ClipVertex scratch[CLIP_MAX_VERTICES];
+      int n = clipPolygon(planes, codes[0] | codes[1] | codes[2], poly, 3,
+                          scratch);
+      Vec2 p0 = n ? screen(poly[0]) : Vec2{};
+      for (int k = 1; k + 1 < n; k++) {
+        Vec2 p1 = screen(poly[k]), p2 = screen(poly[k + 1]);
+        commands.push_back({RasterCmd::Triangle,
+                            {(int)p0.x, (int)p1.x, (int)p2.x},
+                            {(int)p0.y, (int)p1.y, (int)p2.y},
+                            {poly[0].z, poly[k].z, poly[k + 1].z},
+                            {poly[0].i, poly[k].i, poly[k + 1].i},
+                            color});
+      }
+    }
+    if (renderLines) {
+      for (int k = 0; k < 3; k++) {
+        ClipVertex a = cv[k], b = cv[(k + 1) % 3];
+        if (clipSegment(planes, codes[k] | codes[(k + 1) % 3], a, b))
+          pushLine(screen(a), a.z, screen(b), b.z);
+      }
+    }
+    if (renderPoints) {
+      for (int k = 0; k < 3; k++)
+        if (!codes[k])
+          pushPoint(screen(cv[k]), cv[k].z);
+    }
+  }
+
+  // Rango de tiles que toca la caja envolvente del comando
+  bool commandTiles(const RasterCmd &c, int &tx0, int &ty0, int &tx1,
+                    int &ty1) const {
+    int verts = c.type == RasterCmd::Triangle ? 3
+                : c.type == RasterCmd::Line   ? 2
+                                              : 1;
+    int minX = c.x[0], maxX = c.x[0], minY = c.y[0], maxY = c.y[0];
+    for (int k = 1; k < verts; k++) {
+      minX = std::min(minX, c.x[k]);
+      maxX = std::max(maxX, c.x[k]);
+      minY = std::min(minY, c.y[k]);
+      maxY = std::max(maxY, c.y[k]);
+    }
+    minX = std::max(minX, 0);
+    minY = std::max(minY, 0);
+    maxX = std::min(maxX, width - 1);
+    maxY = std::min(maxY, height - 1);
+    if (minX > maxX || minY > maxY)
+      return false;
+    tx0 = minX / TILE_SIZE;
+    ty0 = minY / TILE_SIZE;
+    tx1 = maxX / TILE_SIZE;
+    ty1 = maxY / TILE_SIZE;
+    return true;
+  }
+
+  // Reparte los comandos por tile con un counting sort sobre un arreglo
+  // plano (contar, prefijos, colocar) en vez de un vector por tile
+  void binCommands() {
+    size_t tiles = (size_t)tilesX * tilesY;
+    binStart.assign(tiles + 1, 0);
+    int tx0, ty0, tx1, ty1;
+    for (const auto &c : commands)
+      if (commandTiles(c, tx0, ty0, tx1, ty1))
+        for (int ty = ty0; ty <= ty1; ty++)
+          for (int tx = tx0; tx <= tx1; tx++)
+            binStart[ty * tilesX + tx + 1]++;
+
+    for (size_t t = 0; t < tiles; t++)
+      binStart[t + 1] += binStart[t];
+    binItems.resize(binStart[tiles]);
+    binCursor.assign(binStart.begin(), binStart.end() - 1);
+
+    for (uint32_t k = 0; k < (uint32_t)commands.size(); k++) {
+      uint32_t n = depthSort ? drawOrder[k] : k;
+      if (commandTiles(commands[n], tx0, ty0, tx1, ty1))
+        for (int ty = ty0; ty <= ty1; ty++)
+          for (int tx = tx0; tx <= tx1; tx++)
+            binItems[binCursor[ty * tilesX + tx]++] = n;
+    }
+  }
+
+  // Reordena groupOrder (del frame anterior) por insercion. Devuelve false
+  // si supera 'budget' desplazamientos: el orden cambio demasiado.
+  bool resortGroups(long budget) {
+    auto before = [this](uint32_t a, uint32_t b) {
+      return sortKeys[a] < sortKeys[b] || (sortKeys[a] == sortKeys[b] && a < b);
+    };
+    for (size_t i = 1; i < groupOrder.size(); i++) {
+      uint32_t v = groupOrder[i];
+      size_t j = i;
+      for (; j > 0 && before(v, groupOrder[j - 1]); j--)
+        groupOrder[j] = groupOrder[j - 1];
+      groupOrder[j] = v;
+      budget -= (long)(i - j);
+      if (budget < 0)
+        return false;
+    }
+    return true;
+  }
+
+  // Radix LSD de dos pasadas de 8 bits sobre el orden original (estable)
+  void radixGroups(size_t groups) {
+    groupOrder.resize(groups);
+    sortScratch.resize(groups);
+    for (size_t g = 0; g < groups; g++)
+      sortScratch[g] = (uint32_t)g;
+    for (int shift = 0; shift < 16; shift += 8) {
+      uint32_t count[257] = {};
+      for (uint32_t g : sortScratch)
+        count[((sortKeys[g] >> shift) & 0xFF) + 1]++;
+      for (int b = 0; b < 256; b++)
+        count[b + 1] += count[b];
+      for (uint32_t g : sortScratch)
+        groupOrder[count[(sortKeys[g] >> shift) & 0xFF]++] = g;
+      groupOrder.swap(sortScratch);
+    }
+    groupOrder.swap(sortScratch);
+  }
+
+  // Ordena commands de adelante hacia atras para que el z-buffer (y el Z
+  // jerarquico) descarten lo tapado antes de sombrearlo. Los empates se
+  // rompen por indice, asi que el orden no depende de la historia.
+  void sortCommands() {
+    size_t n = commands.size();
+    size_t groups = (n + SORT_GROUP - 1) / SORT_GROUP;
+    float zMin = INFINITY, zMax = -INFINITY, lo, hi;
+    sortDepth.assign(groups, INFINITY);
+    for (size_t k = 0; k < n; k++) {
+      commandDepth(commands[k], lo, hi);
+      float &d = sortDepth[k / SORT_GROUP];
+      d = std::min(d, lo);
+    }
+    for (float d : sortDepth) {
+      zMin = std::min(zMin, d);
+      zMax = std::max(zMax, d);
+    }
+    float scale = zMax > zMin ? 65535.0f / (zMax - zMin) : 0.0f;
+    sortKeys.resize(groups);
+    for (size_t g = 0; g < groups; g++) {
+      float q = (sortDepth[g] - zMin) * scale; // NaN cae en 0
+      sortKeys[g] = q > 0.0f ? (uint16_t)std::min(q, 65535.0f) : 0;
+    }
+
+    if (groupOrder.size() != groups || !resortGroups((long)groups))
+      radixGroups(groups);
+
+    drawOrder.resize(n);
+    size_t k = 0;
+    for (uint32_t g : groupOrder) {
+      uint32_t end = std::min<uint32_t>((uint32_t)n, (g + 1) * SORT_GROUP);
+      for (uint32_t c = g * SORT_GROUP; c < end; c++)
+        drawOrder[k++] = c;
+    }
+  }
+
+public:
+  Renderer(int w, int h)
+      : width(w), height(h), window(nullptr), renderer(nullptr),
+        color_buffer(nullptr), z_buffer(nullptr),
+        color_buffer_texture(nullptr), simdKernel(selectSpanKernel()),
+        transformKernel(selectTransformKernel()),
+        tilesX((w + TILE_SIZE - 1) / TILE_SIZE),
+        tilesY((h + TILE_SIZE - 1) / TILE_SIZE),
+        tileDepthGen((size_t)tilesX * tilesY, 0),
+        tileZ((size_t)tilesX * tilesY, TileDepth{10000.0f, 10000.0f}) {
+    shadingLut.update(ambient, shadingPower);
+  }
+
+  // presentBuffers > 1 presenta en un hilo aparte con esa cantidad de
+  // buffers de color (2 = doble buffer, 3 = triple); 1 presenta en linea.
+  bool init(int presentBuffers = 1) {
+    if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
+      return false;
+    window = SDL_CreateWindow("3D Renderer (C++)", SDL_WINDOWPOS_CENTERED,
+                              SDL_WINDOWPOS_CENTERED, width, height, 0);
+    if (!window)
+      return false;
+
+    z_buffer = new float[width * height];
+    if (presentBuffers > 1) {
+      // El SDL_Renderer se crea y se usa solo en el hilo de presentacion
+      PresentThread::Hooks hooks;
+      hooks.setup = [this] { return createRenderTarget(); };
+      hooks.deliver = [this](const uint32_t *pixels, int) {
+        SDL_UpdateTexture(color_buffer_texture, NULL, pixels,
+                          width * sizeof(uint32_t));
+        showTexture();
+        return true;
+      };
+      hooks.teardown = [this] { destroyRenderTarget(); };
+      asyncPresent = presenter.start(presentBuffers,
+                                     (size_t)width * height, hooks);
+      return asyncPresent;
+    }
+
+    if (!createRenderTarget())
+      return false;
+    color_buffer = new uint32_t[width * height];
+    return true;
+  }
+
+  // Modo sin ventana para maquinas sin pantalla ni GPU: no inicializa SDL,
+  // solo reserva los buffers. present() entrega cada frame al sink (desde el
+  // hilo de presentacion si presentBuffers > 1).
+  bool initHeadless(FrameSink sink, int presentBuffers = 1) {
+    if (!sink)
+      return false;
+    headless = true;
+    frameSink = std::move(sink);
+    z_buffer = new float[width * height];
+    if (presentBuffers > 1) {
+      PresentThread::Hooks hooks;
+      hooks.deliver = [this](const uint32_t *pixels, int frame) {
+        return frameSink({pixels, width, height, frame});
+      };
+      asyncPresent = presenter.start(presentBuffers,
+                                     (size_t)width * height, hooks);
+      return asyncPresent;
+    }
+    color_buffer = new uint32_t[width * height];
+    return true;
+  }
+
+  // Frame en curso o ultimo rasterizado (ARGB8888, width * height). Con
+  // presentacion directa el frame queda en la textura y este buffer no se
+  // usa; en modo asincrono solo es valido entre clear() y present().
+  const uint32_t *pixels() const { return color_buffer; }
+
+  // El color se borra entero (un barrido de filas completas rinde mas que
+  // rellenar tile por tile); la profundidad, segun lazyClear.
+  void clear(uint32_t color) {
+    beginFrame();
+    commands.clear(); // Lo pendiente quedaria tapado por el borrado
+    for (int y = 0; y < height; y++)
+      std::fill_n(color_target + (size_t)color_pitch * y, width, color);
+    invalidateDepth();
+  }
+
+  // Solo profundidad, para cuando una pasada de fondo cubre toda la
+  // pantalla: el color del frame anterior (o de la textura bloqueada, que es
+  // indefinido) queda hasta que se pinte encima.
+  void clearDepth() {
+    beginFrame();
+    commands.clear();
+    invalidateDepth();
+  }
+
+  void drawPixel(int x, int y, float z, uint32_t color) {
+    beginFrame();
+    resolveClears();
+    tileMinValid = false;
+    if (x >= 0 && x < width && y >= 0 && y < height)
+      plotPixel(x, y, z, color);
+  }
+
+  void drawLine(int x0, int y0, float z0, int x1, int y1, float z1,
+                uint32_t color) {
+    beginFrame();
+    resolveClears();
+    tileMinValid = false;
+    drawLineClipped(x0, y0, z0, x1, y1, z1, color, screenRect());
+  }
+
   void fillTriangle(int x1, int y1, float z1, float i1, int x2, int y2,
                     float z2, float i2, int x3, int y3, float z3, float i3,
                     uint32_t color) {
+    beginFrame();
+    resolveClears();
+    tileMinValid = false;
     if (y1 > y2) {
       std::swap(y1, y2);
       std::swap(x1, x2);
@@ -158,7 +800,10 @@ public:
       std::swap(i2, i3);
     }
 
-    for (int y = y1; y <= y3; y++) {
+    // Filas y tramos se acotan a la pantalla antes de recorrerlos; la
+    // interpolacion usa las coordenadas sin recortar
+    int yBegin = std::max(y1, 0), yEnd = std::min(y3, height - 1);
+    for (int y = yBegin; y <= yEnd; y++) {
       float alpha = (y3 == y1) ? 0 : (float)(y - y1) / (y3 - y1);
       bool second_half = (y > y2 || y2 == y1);
       float beta = second_half ? (y3 == y2 ? 0 : (float)(y - y2) / (y3 - y2))
@@ -178,101 +823,485 @@ public:
         std::swap(iS, iE);
       }
 
-      for (int x = (int)xS; x <= (int)xE; x++) {
+      int xBegin = std::max((int)xS, 0), xEnd = std::min((int)xE, width - 1);
+      for (int x = xBegin; x <= xEnd; x++) {
         float phi = (xE == xS) ? 0 : (float)(x - xS) / (xE - xS);
         phi = std::max(0.0f, std::min(1.0f, phi));
         float z = zS + (zE - zS) * phi;
-        float intensity = iS + (iE - iS) * phi;
-        drawPixel(x, y, z, applyShading(color, intensity));
+        // La intensidad y el sombreado solo para pixeles visibles
+        shadePixel(x, y, z,
+                   [&] { return applyShading(color, iS + (iE - iS) * phi); });
       }
     }
   }
 
+  // Rasterizador half-space: recorre la caja envolvente recortada a la
+  // pantalla y avanza las funciones de arista con sumas enteras. Las
+  // baricentricas son exactas, asi que profundidad e intensidad se obtienen
+  // sin divisiones por pixel (una sola division por triangulo).
+  void fillTriangleEdge(int x1, int y1, float z1, float i1, int x2, int y2,
+                        float z2, float i2, int x3, int y3, float z3, float i3,
+                        uint32_t color) {
+    RasterCmd c = {RasterCmd::Triangle, {x1, x2, x3}, {y1, y2, y3},
+                   {z1, z2, z3},        {i1, i2, i3}, color};
+    beginFrame();
+    resolveClears();
+    tileMinValid = false;
+    rasterTriangleEdge(c, screenRect());
+  }
+
+  // Devuelve true si el triangulo cubre todo 'r'. depthTest = false solo
+  // cuando se sabe que todo pixel cubierto pasa la prueba. Con visId != 0
+  // escribe ese valor en visBuffer en vez de sombrear.
+  bool rasterTriangleEdge(const RasterCmd &c, const ClipRect &r,
+                          bool depthTest = true,
+                          SpanPass pass = SpanPass::Full,
+                          uint32_t visId = 0) {
+    int x1 = c.x[0], y1 = c.y[0], x2 = c.x[1], y2 = c.y[1], x3 = c.x[2],
+        y3 = c.y[2];
+    float z1 = c.z[0], z2 = c.z[1], z3 = c.z[2];
+    float i1 = c.i[0], i2 = c.i[1], i3 = c.i[2];
+
+    int64_t area = edgeFunction(x1, y1, x2, y2, x3, y3);
+    if (area == 0)
+      return false; // Triangulo degenerado
+    if (area < 0) {
+      std::swap(x2, x3);
+      std::swap(y2, y3);
+      std::swap(z2, z3);
+      std::swap(i2, i3);
+      area = -area;
+    }
+
+    int minX = std::max(std::min({x1, x2, x3}), r.x0);
+    int maxX = std::min(std::max({x1, x2, x3}), r.x1);
+    int minY = std::max(std::min({y1, y2, y3}), r.y0);
+    int maxY = std::min(std::max({y1, y2, y3}), r.y1);
+    if (minX > maxX || minY > maxY)
+      return false;
+
+    // Pasos por columna (dx) y fila (dy) de cada arista
+    int32_t a0 = y2 - y3, b0 = x3 - x2; // w0: arista v2->v3 (peso de v1)
+    int32_t a1 = y3 - y1, b1 = x1 - x3; // w1: arista v3->v1 (peso de v2)
+    int32_t a2 = y1 - y2, b2 = x2 - x1; // w2: arista v1->v2 (peso de v3)
+
+    SpanSetup s;
+    s.a0 = a0;
+    s.a1 = a1;
+    s.a2 = a2;
+
+    // Sesgo de la regla top-left (0 o -1) aplicado solo a la prueba
+    int64_t bias0 = isTopLeft(x2, y2, x3, y3) ? 0 : -1;
+    s.bias1 = isTopLeft(x3, y3, x1, y1) ? 0 : -1;
+    s.bias2 = isTopLeft(x1, y1, x2, y2) ? 0 : -1;
+
+    int64_t w0Row = edgeFunction(x2, y2, x3, y3, minX, minY) + bias0;
+    int64_t w1Row = edgeFunction(x3, y3, x1, y1, minX, minY) + s.bias1;
+    int64_t w2Row = edgeFunction(x1, y1, x2, y2, minX, minY) + s.bias2;
+
+    // Atributo = v1 + w1 * (v2 - v1) / area + w2 * (v3 - v1) / area
+    float invArea = 1.0f / (float)area;
+    s.z1 = z1;
+    s.dz1 = (z2 - z1) * invArea;
+    s.dz2 = (z3 - z1) * invArea;
+    s.i1 = i1;
+    s.di1 = (i2 - i1) * invArea;
+    s.di2 = (i3 - i1) * invArea;
+    s.color = visId ? visId : c.color;
+    s.shade = useShading && !visId;
+    s.lut = &shadingLut;
+    s.depthTest = depthTest;
+    s.pass = pass;
+
+    // Los kernels SIMD usan enteros de 32 bits: solo con coordenadas acotadas
+    const int limit = 1 << 13;
+    bool fits32 = std::max({std::abs(x1), std::abs(x2), std::abs(x3),
+                            std::abs(y1), std::abs(y2), std::abs(y3)}) <=
+                      limit &&
+                  width <= limit && height <= limit;
+    SpanKernel kernel = (useSimd && fits32) ? simdKernel : spanScalar;
+
+    // Cubre 'r' si su caja lo abarca y las cuatro esquinas estan dentro
+    int count = maxX - minX + 1, rows = maxY - minY;
+    bool covers = minX == r.x0 && maxX == r.x1 && minY == r.y0 &&
+                  maxY == r.y1;
+    for (int k = 0; k < 4 && covers; k++) {
+      int64_t dx = (k & 1) ? count - 1 : 0, dy = (k & 2) ? rows : 0;
+      int64_t e0 = w0Row + a0 * dx + b0 * dy;
+      int64_t e1 = w1Row + a1 * dx + b1 * dy;
+      int64_t e2 = w2Row + a2 * dx + b2 * dy;
+      covers = (e0 | e1 | e2) >= 0;
+    }
+
+    uint32_t *target = visId ? visBuffer.data() : color_target;
+    int pitch = visId ? width : color_pitch;
+    for (int y = minY; y <= maxY; y++) {
+      uint32_t *color = target + pitch * y + minX;
+      kernel(s, w0Row, w1Row, w2Row, count, color, z_buffer + width * y + minX);
+      w0Row += b0;
+      w1Row += b1;
+      w2Row += b2;
+    }
+    return covers;
+  }
+
   void renderMesh(const Mesh &mesh, float angleX, float angleY, float angleZ) {
-    std::vector<Vec3> tv = mesh.vertices;
-    std::vector<Vec3> vn(mesh.vertices.size(), Vec3(0, 0, 0));
+    renderMesh(mesh, Mat4::rotationXYZ(angleX, angleY, angleZ));
+  }
 
-    // 1. Transformación de rotación
-    for (auto &v : tv) {
-      v = v.rotateX(angleX).rotateY(angleY).rotateZ(angleZ);
+  // Cono de normales entero de espaldas: ninguna cara del cluster mira a la
+  // camara desde ningun punto de su esfera (la misma prueba fn . a >= 0 que
+  // descarta caras sueltas). 'center' ya esta en espacio de vista y
+  // modelView debe ser una rotacion por la escala uniforme 'scale' (con
+  // otra escala las normales no giran como los puntos y el cono no vale).
+  bool coneBackFacing(const MeshCluster &c, const Mat4 &modelView,
+                      float scale, const Vec3 &center) const {
+    if (c.coneCutoff > 1.0f)
+      return false;
+    Vec3 axis = modelView.transformDirection(c.coneAxis) / scale;
+    if (!isPerspective) // Se mira a lo largo de +z
+      return axis.z >= c.coneCutoff;
+    return center.dot(axis) >=
+           c.coneCutoff * center.length() + c.radius * scale;
+  }
+
+  // Clusters de 'mesh' que tocan la vista y pueden tener caras de frente:
+  // llena faceSpans y vertexSpans (ordenados y sin solapes). false si no
+  // queda ninguno. 'scale' acota cuanto agranda modelView las esferas.
+  bool cullClusters(const Mesh &mesh, const Mat4 &modelView, float scale,
+                    const Frustum &frustum) {
+    size_t count = mesh.vertices.size();
+    float uniform;
+    bool cones = coneCull && !renderBackface &&
+                 modelView.uniformScale(uniform);
+    faceSpans.clear();
+    vertexSpans.clear();
+    for (const MeshCluster &c : mesh.clusters) {
+      Vec3 center = modelView.transformPoint(c.center);
+      if (frustumCull && frustum.culls(center, c.radius * scale))
+        continue;
+      if (cones && coneBackFacing(c, modelView, uniform, center))
+        continue;
+      if (!faceSpans.empty() && faceSpans.back().end == c.firstFace)
+        faceSpans.back().end += c.faceCount;
+      else
+        faceSpans.push_back({c.firstFace, (size_t)c.firstFace + c.faceCount});
+      vertexSpans.push_back({std::min<size_t>(c.firstVertex, count),
+                             std::min<size_t>(c.endVertex, count)});
+    }
+    std::sort(vertexSpans.begin(), vertexSpans.end(),
+              [](const IndexSpan &a, const IndexSpan &b) {
+                return a.begin < b.begin;
+              });
+    size_t merged = 0;
+    for (const IndexSpan &v : vertexSpans) {
+      if (merged > 0 && v.begin <= vertexSpans[merged - 1].end)
+        vertexSpans[merged - 1].end =
+            std::max(vertexSpans[merged - 1].end, v.end);
+      else
+        vertexSpans[merged++] = v;
+    }
+    vertexSpans.resize(merged);
+    return !faceSpans.empty();
+  }
+
+  // Transforma y proyecta la malla; las primitivas se rasterizan en flush().
+  // Con frustumCull, una malla fuera de la vista se descarta por su esfera.
+  // Si tiene clusters, solo se procesan los vertices y caras de los que
+  // tocan la vista (frustumCull) y no estan de espaldas (coneCull). 'model'
+  // puede escalar: los radios se agrandan con la cota de su estiramiento y
+  // las normales pasan por la inversa traspuesta.
+  void renderMesh(const Mesh &mesh, const Mat4 &model) {
+    size_t count = mesh.vertices.size();
+    Mat4 modelView = view * model;
+    float scale = modelView.maxScale();
+    Frustum frustum = Frustum::fromProjection(
+        projection(), width / 2.0f, height / 2.0f, nearPlane, farPlane);
+    if (frustumCull && mesh.boundsRadius >= 0 &&
+        frustum.culls(modelView.transformPoint(mesh.boundsCenter),
+                      mesh.boundsRadius * scale))
+      return;
+
+    if ((frustumCull || coneCull) && mesh.hasClusters()) {
+      if (!cullClusters(mesh, modelView, scale, frustum))
+        return;
+    } else {
+      faceSpans.assign(1, {0, mesh.faces.size()});
+      vertexSpans.assign(1, {0, count});
     }
 
-    // Normales por vertice (promedio de caras)
-    for (const auto &f : mesh.faces) {
-      Vec3 n = (tv[f.b] - tv[f.a]).cross(tv[f.c] - tv[f.a]);
-      vn[f.a] = vn[f.a] + n;
-      vn[f.b] = vn[f.b] + n;
-      vn[f.c] = vn[f.c] + n;
+    // Las normales se precalculan al cargar; si la malla no las trae se
+    // calculan aqui (en espacio de modelo) como antes
+    const Vec3Array *normals = &mesh.normals;
+    if (!mesh.hasNormals()) {
+      mesh.computeNormals(fallbackNormals);
+      normals = &fallbackNormals;
     }
-    for (auto &n : vn)
-      n.normalize();
 
-    // 2. Traslación (Z-offset para que el cubo esté "dentro" de la escena)
-    for (auto &v : tv)
-      v.z += 5.0f;
+    // 1. Transformación: modelo-vista y proyección compuestas una vez y
+    // aplicadas en bloques de vertices repartidos entre los hilos. Las
+    // normales solo se rotan si 'model' no escala
+    float uniform;
+    bool rigid = modelView.uniformScale(uniform) &&
+                 std::abs(uniform - 1.0f) <= 1e-4f;
+    Mat4 normalMat = rigid ? modelView : modelView.normalMatrix();
+    VertexStage stage = {modelView, normalMat, projection(), width / 2.0f,
+                         height / 2.0f, !rigid};
+    TransformKernel kernel = useSimd ? transformKernel : transformScalar;
+    xf.resize(count);
+    const size_t chunk = 4096;
+    vertexChunks.clear();
+    for (const IndexSpan &v : vertexSpans)
+      for (size_t begin = v.begin; begin < v.end; begin += chunk)
+        vertexChunks.push_back({begin, std::min(begin + chunk, v.end)});
+    pool.parallelFor((int)vertexChunks.size(), [&](int n) {
+      kernel(stage, mesh.vertices, *normals, vertexChunks[n].begin,
+             vertexChunks[n].end, xf);
+    });
 
     // Posición de la luz para degradado (Puntual desde el hombro superior)
     Vec3 lightPos(2, -2, 0);
 
-    for (const auto &f : mesh.faces) {
-      Vec3 a = tv[f.a], b = tv[f.b], c = tv[f.c];
+    // Shading: Luz puntual para crear gradiante progresivo
+    auto calcInt = [&](Vec3 v, Vec3 n) {
+      Vec3 dir = (v - lightPos);
+      dir.normalize();
+      return std::max(0.0f, n.dot(dir * -1.0f));
+    };
 
-      // Face Normal
-      Vec3 fn = (b - a).cross(c - a);
+    ClipPlanes planes = clipPlanes();
+    const Face *faces = mesh.faces.data();
+    for (const IndexSpan &span : faceSpans)
+      for (size_t k = span.begin; k < span.end; k++) {
+        const Face &f = faces[k];
+        Vec3 a = xf.view(f.a), b = xf.view(f.b), c = xf.view(f.c);
 
-      // View vector (desde cámara en 0,0,0 hacia el objeto)
-      // En orto, la cámara "ve" paralela al eje Z.
-      Vec3 view = isPerspective ? a : Vec3(0, 0, 1);
+        // Face Normal
+        Vec3 fn = (b - a).cross(c - a);
 
-      // Culling: Si fn.dot(view) < 0, la cara mira a la camara
-      bool isVisible = renderBackface ? true : (fn.dot(view) < 0);
+        // View vector (desde cámara en 0,0,0 hacia el objeto)
+        // En orto, la cámara "ve" paralela al eje Z.
+        Vec3 eyeDir = isPerspective ? a : Vec3(0, 0, 1);
 
-      if (isVisible) {
-        Vec2 pA = project(a), pB = project(b), pC = project(c);
+        // Culling: Si fn.dot(eyeDir) < 0, la cara mira a la camara
+        bool isVisible = renderBackface ? true : (fn.dot(eyeDir) < 0);
+        if (!isVisible)
+          continue;
 
+        // Recorte: fuera de un mismo plano se descarta entera; si solo lo
+        // cruza, se recorta. Lo que cae dentro de la banda de guarda sigue el
+        // camino normal.
+        uint8_t codes[3] = {clipCode(f.a, planes), clipCode(f.b, planes),
+                            clipCode(f.c, planes)};
+        if (codes[0] & codes[1] & codes[2])
+          continue;
+
+        float i1 = 0, i2 = 0, i3 = 0;
         if (renderTriangles) {
-          // Shading: Luz puntual para crear gradiante progresivo
-          auto calcInt = [&](Vec3 v, Vec3 n) {
-            Vec3 dir = (v - lightPos);
-            dir.normalize();
-            return std::max(0.0f, n.dot(dir * -1.0f));
-          };
-
-          float i1 = calcInt(a, vn[f.a]);
-          float i2 = calcInt(b, vn[f.b]);
-          float i3 = calcInt(c, vn[f.c]);
-
-          fillTriangle((int)pA.x, (int)pA.y, a.z, i1, (int)pB.x, (int)pB.y, b.z,
-                       i2, (int)pC.x, (int)pC.y, c.z, i3, f.color);
+          i1 = calcInt(a, xf.normal(f.a));
+          i2 = calcInt(b, xf.normal(f.b));
+          i3 = calcInt(c, xf.normal(f.c));
         }
+
+        if (codes[0] | codes[1] | codes[2]) {
+          emitClipped(stage.proj, planes, {a, b, c}, {i1, i2, i3}, codes,
+                      f.color);
+          continue;
+        }
+
+        Vec2 pA = xf.screen(f.a), pB = xf.screen(f.b), pC = xf.screen(f.c);
+
+        if (renderTriangles)
+          commands.push_back({RasterCmd::Triangle,
+                              {(int)pA.x, (int)pB.x, (int)pC.x},
+                              {(int)pA.y, (int)pB.y, (int)pC.y},
+                              {a.z, b.z, c.z},
+                              {i1, i2, i3},
+                              f.color});
         if (renderLines) {
-          uint32_t lc = 0xFFFFFFFF;
-          drawLine((int)pA.x, (int)pA.y, a.z, (int)pB.x, (int)pB.y, b.z, lc);
-          drawLine((int)pB.x, (int)pB.y, b.z, (int)pC.x, (int)pC.y, c.z, lc);
-          drawLine((int)pC.x, (int)pC.y, c.z, (int)pA.x, (int)pA.y, a.z, lc);
+          pushLine(pA, a.z, pB, b.z);
+          pushLine(pB, b.z, pC, c.z);
+          pushLine(pC, c.z, pA, a.z);
         }
         if (renderPoints) {
-          uint32_t pc = 0xFFFF0000;
-          drawPixel((int)pA.x, (int)pA.y, a.z - 0.2f, pc);
-          drawPixel((int)pB.x, (int)pB.y, b.z - 0.2f, pc);
-          drawPixel((int)pC.x, (int)pC.y, c.z - 0.2f, pc);
+          pushPoint(pA, a.z);
+          pushPoint(pB, b.z);
+          pushPoint(pC, c.z);
         }
       }
+  }
+
+  // Mismo orden de vertices y gradientes que rasterTriangleEdge, para que
+  // el pase diferido reproduzca exactamente su intensidad
+  static void setupVisTriangle(const RasterCmd &c, VisTriangle &v) {
+    v = {c.x[0], c.y[0], c.x[1], c.y[1], c.x[2], c.y[2],
+         c.i[0], 0.0f,   0.0f,   c.color};
+    float i2 = c.i[1], i3 = c.i[2];
+    int64_t area = edgeFunction(v.x1, v.y1, v.x2, v.y2, v.x3, v.y3);
+    if (area == 0)
+      return;
+    if (area < 0) {
+      std::swap(v.x2, v.x3);
+      std::swap(v.y2, v.y3);
+      std::swap(i2, i3);
+      area = -area;
     }
+    float invArea = 1.0f / (float)area;
+    v.di1 = (i2 - v.i1) * invArea;
+    v.di2 = (i3 - v.i1) * invArea;
   }
 
-  void present() {
-    SDL_UpdateTexture(color_buffer_texture, NULL, color_buffer,
-                      width * sizeof(uint32_t));
-    SDL_RenderCopy(renderer, color_buffer_texture, NULL, NULL);
-    SDL_RenderPresent(renderer);
+  // Pase de sombreado diferido: un recorrido lineal de 'r' que sombrea cada
+  // pixel una sola vez con el triangulo que quedo visible. Las funciones de
+  // arista se evaluan en el pixel, asi que el color es el mismo que daria
+  // el rasterizador directo.
+  void shadeVisibility(const ClipRect &r) {
+    for (int y = r.y0; y <= r.y1; y++) {
+      uint32_t *ids = visBuffer.data() + width * y;
+      uint32_t *color = color_target + color_pitch * y;
+      for (int x = r.x0; x <= r.x1; x++) {
+        uint32_t id = ids[x];
+        if (!id)
+          continue;
+        ids[x] = 0; // Queda limpio para el proximo flush
+        const VisTriangle &v = visTris[id - 1];
+        if (!useShading) {
+          color[x] = v.color;
+          continue;
+        }
+        float fw1 = (float)edgeFunction(v.x3, v.y3, v.x1, v.y1, x, y);
+        float fw2 = (float)edgeFunction(v.x1, v.y1, v.x2, v.y2, x, y);
+        float intensity = v.i1 + fw1 * v.di1 + fw2 * v.di2;
+        color[x] = shadeColor(v.color, intensity, shadingLut);
+      }
+    }
+  }
+
+  // Dibuja items[0..n) (indices a commands; nullptr = en orden) dentro de
+  // 'r', con las cotas 'tz' del tile si hay Z jerarquico.
+  //  - Z-prepass: los triangulos pasan dos veces, solo profundidad y luego
+  //    color donde coincide. La segunda va en orden inverso para que en un
+  //    empate exacto gane el primero, como sin prepass.
+  //  - Visibilidad: los triangulos escriben profundidad e id y despues
+  //    shadeVisibility() sombrea 'r' de una vez.
+  // En ambos modos lineas y puntos se dibujan al final contra la
+  // profundidad ya completa.
+  void rasterizeList(const uint32_t *items, size_t n, const ClipRect &r,
+                     TileDepth *tz) {
+    auto draw = [&](size_t k, SpanPass pass, bool triangles, bool vis) {
+      uint32_t index = items ? items[k] : (uint32_t)k;
+      const RasterCmd &c = commands[index];
+      if ((c.type == RasterCmd::Triangle) != triangles)
+        return;
+      uint32_t visId = vis ? index + 1 : 0;
+      if (tz)
+        rasterizeHiZ(c, r, *tz, pass, visId);
+      else
+        rasterize(c, r, pass, visId);
+    };
+    bool deferred = visibility && useEdgeRaster;
+    if (!deferred && (!zPrepass || !useEdgeRaster)) {
+      for (size_t k = 0; k < n; k++) {
+        const RasterCmd &c = commands[items ? items[k] : k];
+        draw(k, SpanPass::Full, c.type == RasterCmd::Triangle, false);
+      }
+      return;
+    }
+    if (deferred) {
+      for (size_t k = 0; k < n; k++)
+        draw(k, SpanPass::Full, true, true);
+      shadeVisibility(r);
+    } else {
+      for (size_t k = 0; k < n; k++)
+        draw(k, SpanPass::DepthOnly, true, false);
+      for (size_t k = n; k-- > 0;)
+        draw(k, SpanPass::DepthEqual, true, false);
+    }
+    for (size_t k = 0; k < n; k++)
+      draw(k, SpanPass::Full, false, false);
+  }
+
+  // Rasteriza las primitivas acumuladas. Con tiles, cada hilo procesa tiles
+  // completos en orden de envio, asi que el resultado es identico al serie.
+  void flush() {
+    if (commands.empty())
+      return;
+    beginFrame();
+    if (depthSort)
+      sortCommands();
+    if (visibility && useEdgeRaster) {
+      // El buffer se reserva una vez y shadeVisibility() lo deja en cero
+      visBuffer.resize((size_t)width * height, 0);
+      size_t count = commands.size(), chunk = 4096;
+      visTris.resize(count);
+      pool.parallelFor((int)((count + chunk - 1) / chunk), [&](int n) {
+        size_t end = std::min(count, n * chunk + chunk);
+        for (size_t k = n * chunk; k < end; k++)
+          if (commands[k].type == RasterCmd::Triangle)
+            setupVisTriangle(commands[k], visTris[k]);
+      });
+    }
+    if (useEdgeRaster && useTiles) {
+      if (!useHiZ)
+        tileMinValid = false; // Las cotas no se mantienen en este frame
+      binCommands();
+      pool.parallelFor(tilesX * tilesY, [&](int t) {
+        if (binStart[t] == binStart[t + 1])
+          return;
+        resolveDepth(t);
+        rasterizeList(binItems.data() + binStart[t],
+                      binStart[t + 1] - binStart[t], tileRect(t),
+                      useHiZ ? &tileZ[t] : nullptr);
+      });
+    } else {
+      resolveClears();
+      tileMinValid = false;
+      rasterizeList(depthSort ? drawOrder.data() : nullptr, commands.size(),
+                    screenRect(), nullptr);
+    }
+    commands.clear();
+  }
+
+  // Devuelve false si el sink no pudo escribir el frame (en modo asincrono,
+  // si fallo alguno de los anteriores)
+  bool present() {
+    flush();
+    if (asyncPresent) {
+      beginFrame(); // Por si el frame no dibujo nada
+      presenter.submit(frameIndex++);
+      frameStarted = false;
+      color_buffer = nullptr;
+      return !presenter.failed();
+    }
+    frameStarted = false;
+    if (headless)
+      return frameSink({color_buffer, width, height, frameIndex++});
+    if (textureLocked) {
+      SDL_UnlockTexture(color_buffer_texture); // El frame ya esta en ella
+      textureLocked = false;
+    } else {
+      SDL_UpdateTexture(color_buffer_texture, NULL, color_buffer,
+                        width * sizeof(uint32_t));
+    }
+    showTexture();
+    return true;
   }
 
   void destroy() {
-    delete[] color_buffer;
+    if (asyncPresent) {
+      presenter.stop(); // Presenta lo pendiente y libera sus buffers
+      asyncPresent = false;
+    } else {
+      delete[] color_buffer;
+    }
     delete[] z_buffer;
-    SDL_DestroyTexture(color_buffer_texture);
-    SDL_DestroyRenderer(renderer);
+    color_buffer = nullptr;
+    z_buffer = nullptr;
+    if (headless)
+      return;
+    if (textureLocked)
+      SDL_UnlockTexture(color_buffer_texture);
+    destroyRenderTarget();
     SDL_DestroyWindow(window);
     SDL_Quit();
   }
@@ -0,0 +1,154 @@
+#ifndef VERTEXKERNELS_H
+#define VERTEXKERNELS_H
+
+#include "../Core/AlignedAllocator.h"
+#include "../Math/Mat4.h"
+#include "../Math/Vec2.h"
+#include "../Math/Vec3Array.h"
+#include "RasterKernels.h"
+#include <cstddef>
+
+// Salida de la etapa de vertices (SoA), reutilizada entre frames
+struct TransformedVertices {
+  AlignedVector<float> vx, vy, vz; // Espacio de vista
+  AlignedVector<float> nx, ny, nz; // Normales en espacio de vista
+  AlignedVector<float> sx, sy;     // Pantalla (pixeles)
+
+  void resize(size_t n) {
+    vx.resize(n);
+    vy.resize(n);
+    vz.resize(n);
+    nx.resize(n);
+    ny.resize(n);
+    nz.resize(n);
+    sx.resize(n);
+    sy.resize(n);
+  }
+
+  Vec3 view(size_t i) const { return Vec3(vx[i], vy[i], vz[i]); }
+  Vec3 normal(size_t i) const { return Vec3(nx[i], ny[i], nz[i]); }
+  Vec2 screen(size_t i) const { return {sx[i], sy[i]}; }
+};
+
+// Parametros de la etapa: modelo-vista, matriz de normales, proyeccion y
+// centro del viewport. Con modelo-vista rigida la matriz de normales es la
+// misma y no hace falta renormalizar; si escala, es su inversa traspuesta
+// (Mat4::normalMatrix) y las normales se vuelven a hacer unitarias.
+struct VertexStage {
+  Mat4 modelView, normals, proj;
+  float cx, cy;
+  bool renormalize;
+};
+
+// Transforma y proyecta los vertices [begin, end). Las normales salen
+// unitarias en espacio de vista.
+using TransformKernel = void (*)(const VertexStage &st, const Vec3Array &in,
+                                 const Vec3Array &normals, size_t begin,
+                                 size_t end, TransformedVertices &out);
+
+inline void transformScalar(const VertexStage &st, const Vec3Array &in,
+                            const Vec3Array &normals, size_t begin,
+                            size_t end, TransformedVertices &out) {
+  for (size_t k = begin; k < end; k++) {
+    Vec3 n = st.normals.transformDirection(normals[k]);
+    if (st.renormalize)
+      n.normalize();
+    out.nx[k] = n.x;
+    out.ny[k] = n.y;
+    out.nz[k] = n.z;
+
+    Vec3 v = st.modelView.transformPoint(in[k]);
+    Vec4 p = st.proj * Vec4(v, 1.0f);
+    // Division de perspectiva + viewport. En SDL +Y es abajo; dejamos que el
+    // sistema de coordenadas sea el que es.
+    float w = std::max(0.1f, p.w);
+    out.vx[k] = v.x;
+    out.vy[k] = v.y;
+    out.vz[k] = v.z;
+    out.sx[k] = p.x / w + st.cx;
+    out.sy[k] = p.y / w + st.cy;
+  }
+}
+
+#ifdef RASTER_X86
+
+// Fila de la matriz por (x, y, z, 1) para 8 vertices
+RASTER_TARGET("avx")
+inline __m256 transformRowAVX(const float (&r)[4], __m256 x, __m256 y,
+                              __m256 z) {
+  __m256 a = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(r[0]), x),
+                           _mm256_mul_ps(_mm256_set1_ps(r[1]), y));
+  a = _mm256_add_ps(a, _mm256_mul_ps(_mm256_set1_ps(r[2]), z));
+  return _mm256_add_ps(a, _mm256_set1_ps(r[3]));
+}
+
+// Fila de la matriz por (x, y, z, 0): direcciones sin traslacion
+RASTER_TARGET("avx")
+inline __m256 rotateRowAVX(const float (&r)[4], __m256 x, __m256 y,
+                           __m256 z) {
+  __m256 a = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(r[0]), x),
+                           _mm256_mul_ps(_mm256_set1_ps(r[1]), y));
+  return _mm256_add_ps(a, _mm256_mul_ps(_mm256_set1_ps(r[2]), z));
+}
+
+// 8 vertices por iteracion; mismo orden de operaciones que la version escalar
+RASTER_TARGET("avx")
+inline void transformAVX(const VertexStage &st, const Vec3Array &in,
+                         const Vec3Array &normals, size_t begin, size_t end,
+                         TransformedVertices &out) {
+  const __m256 nearW = _mm256_set1_ps(0.1f);
+  const __m256 cx = _mm256_set1_ps(st.cx), cy = _mm256_set1_ps(st.cy);
+
+  size_t k = begin;
+  for (; k + 8 <= end; k += 8) {
+    __m256 nx = _mm256_loadu_ps(&normals.x[k]);
+    __m256 ny = _mm256_loadu_ps(&normals.y[k]);
+    __m256 nz = _mm256_loadu_ps(&normals.z[k]);
+    __m256 tx = rotateRowAVX(st.normals.m[0], nx, ny, nz);
+    __m256 ty = rotateRowAVX(st.normals.m[1], nx, ny, nz);
+    __m256 tz = rotateRowAVX(st.normals.m[2], nx, ny, nz);
+    if (st.renormalize) {
+      // Como Vec3::normalize: largo 0 queda igual
+      __m256 len = _mm256_sqrt_ps(
+          _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, tx),
+                                      _mm256_mul_ps(ty, ty)),
+                        _mm256_mul_ps(tz, tz)));
+      __m256 live = _mm256_cmp_ps(len, _mm256_setzero_ps(), _CMP_GT_OQ);
+      tx = _mm256_blendv_ps(tx, _mm256_div_ps(tx, len), live);
+      ty = _mm256_blendv_ps(ty, _mm256_div_ps(ty, len), live);
+      tz = _mm256_blendv_ps(tz, _mm256_div_ps(tz, len), live);
+    }
+    _mm256_storeu_ps(&out.nx[k], tx);
+    _mm256_storeu_ps(&out.ny[k], ty);
+    _mm256_storeu_ps(&out.nz[k], tz);
+
+    __m256 x = _mm256_loadu_ps(&in.x[k]);
+    __m256 y = _mm256_loadu_ps(&in.y[k]);
+    __m256 z = _mm256_loadu_ps(&in.z[k]);
+    __m256 vx = transformRowAVX(st.modelView.m[0], x, y, z);
+    __m256 vy = transformRowAVX(st.modelView.m[1], x, y, z);
+    __m256 vz = transformRowAVX(st.modelView.m[2], x, y, z);
+    __m256 px = transformRowAVX(st.proj.m[0], vx, vy, vz);
+    __m256 py = transformRowAVX(st.proj.m[1], vx, vy, vz);
+    __m256 pw = transformRowAVX(st.proj.m[3], vx, vy, vz);
+    pw = _mm256_max_ps(pw, nearW);
+    _mm256_storeu_ps(&out.vx[k], vx);
+    _mm256_storeu_ps(&out.vy[k], vy);
+    _mm256_storeu_ps(&out.vz[k], vz);
+    _mm256_storeu_ps(&out.sx[k], _mm256_add_ps(_mm256_div_ps(px, pw), cx));
+    _mm256_storeu_ps(&out.sy[k], _mm256_add_ps(_mm256_div_ps(py, pw), cy));
+  }
+  transformScalar(st, in, normals, k, end, out);
+}
+
+#endif
+
+inline TransformKernel selectTransformKernel() {
+#ifdef RASTER_X86
+  if (SDL_HasAVX())
+    return transformAVX;
+#endif
+  return transformScalar;
+}
+
+#endif
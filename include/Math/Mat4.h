@@ -0,0 +1,176 @@
+#ifndef MAT4_H
+#define MAT4_H
+
+#include "Vec3.h"
+#include "Vec4.h"
+#include <algorithm>
+#include <cmath>
+
+// Matriz 4x4 fila-mayor (m[fila][columna]) que multiplica vectores columna:
+// v' = M * v. Las transformaciones se componen de derecha a izquierda.
+struct Mat4 {
+  float m[4][4];
+
+  static Mat4 identity() {
+    Mat4 r;
+    for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++)
+        r.m[i][j] = (i == j) ? 1.0f : 0.0f;
+    return r;
+  }
+
+  static Mat4 translation(float x, float y, float z) {
+    Mat4 r = identity();
+    r.m[0][3] = x;
+    r.m[1][3] = y;
+    r.m[2][3] = z;
+    return r;
+  }
+
+  // Rotaciones con el mismo sentido que Vec3::rotateX/Y/Z
+  static Mat4 rotationX(float angle) {
+    float c = std::cos(angle), s = std::sin(angle);
+    Mat4 r = identity();
+    r.m[1][1] = c;
+    r.m[1][2] = -s;
+    r.m[2][1] = s;
+    r.m[2][2] = c;
+    return r;
+  }
+
+  static Mat4 rotationY(float angle) {
+    float c = std::cos(angle), s = std::sin(angle);
+    Mat4 r = identity();
+    r.m[0][0] = c;
+    r.m[0][2] = -s;
+    r.m[2][0] = s;
+    r.m[2][2] = c;
+    return r;
+  }
+
+  static Mat4 rotationZ(float angle) {
+    float c = std::cos(angle), s = std::sin(angle);
+    Mat4 r = identity();
+    r.m[0][0] = c;
+    r.m[0][1] = -s;
+    r.m[1][0] = s;
+    r.m[1][1] = c;
+    return r;
+  }
+
+  // Rota en X, luego Y, luego Z (mismo orden que encadenar Vec3::rotate*)
+  static Mat4 rotationXYZ(float ax, float ay, float az) {
+    return rotationZ(az) * rotationY(ay) * rotationX(ax);
+  }
+
+  // Perspectiva en pixeles: x' = x * focal / z, con w = z
+  static Mat4 perspective(float focal) {
+    Mat4 r = identity();
+    r.m[0][0] = focal;
+    r.m[1][1] = focal;
+    r.m[3][2] = 1.0f;
+    r.m[3][3] = 0.0f;
+    return r;
+  }
+
+  // Ortogonal en pixeles: x' = x * scale, con w = 1
+  static Mat4 orthographic(float scale) {
+    Mat4 r = identity();
+    r.m[0][0] = scale;
+    r.m[1][1] = scale;
+    return r;
+  }
+
+  Mat4 operator*(const Mat4 &o) const {
+    Mat4 r;
+    for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++)
+        r.m[i][j] = m[i][0] * o.m[0][j] + m[i][1] * o.m[1][j] +
+                    m[i][2] * o.m[2][j] + m[i][3] * o.m[3][j];
+    return r;
+  }
+
+  Vec4 operator*(const Vec4 &v) const {
+    return Vec4(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z + m[0][3] * v.w,
+                m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z + m[1][3] * v.w,
+                m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z + m[2][3] * v.w,
+                m[3][0] * v.x + m[3][1] * v.y + m[3][2] * v.z + m[3][3] * v.w);
+  }
+
+  // Punto (w = 1), sin division de perspectiva
+  Vec3 transformPoint(const Vec3 &v) const {
+    return Vec3(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z + m[0][3],
+                m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z + m[1][3],
+                m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z + m[2][3]);
+  }
+
+  // Direccion (w = 0): ignora la traslacion
+  Vec3 transformDirection(const Vec3 &v) const {
+    return Vec3(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+                m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+                m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z);
+  }
+
+  // M^T M de la parte 3x3: cuanto estira la transformacion cada direccion
+  void gram(float g[3][3]) const {
+    for (int i = 0; i < 3; i++)
+      for (int j = 0; j < 3; j++)
+        g[i][j] = m[0][i] * m[0][j] + m[1][i] * m[1][j] + m[2][i] * m[2][j];
+  }
+
+  // Cota del estiramiento de la parte 3x3 (|M v| <= maxScale() |v|), por
+  // Gershgorin sobre M^T M: exacta para rotacion con escala por eje y
+  // nunca menor que la real
+  float maxScale() const {
+    float g[3][3];
+    gram(g);
+    float bound = 0;
+    for (int i = 0; i < 3; i++)
+      bound = std::max(bound, std::abs(g[i][0]) + std::abs(g[i][1]) +
+                                  std::abs(g[i][2]));
+    return std::sqrt(bound);
+  }
+
+  float determinant3() const {
+    return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+           m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+           m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+  }
+
+  // Inversa traspuesta de la parte 3x3 (sin traslacion): lleva normales
+  // de modelo a vista aun con escala no uniforme, aunque sin conservar su
+  // largo. Si la matriz es singular quedan los cofactores sin dividir.
+  Mat4 normalMatrix() const {
+    Mat4 r = identity();
+    for (int i = 0; i < 3; i++)
+      for (int j = 0; j < 3; j++) {
+        int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+        int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+        r.m[i][j] = m[i1][j1] * m[i2][j2] - m[i1][j2] * m[i2][j1];
+      }
+    float det = determinant3();
+    if (det != 0)
+      for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+          r.m[i][j] /= det;
+    return r;
+  }
+
+  // true si la parte 3x3 es una rotacion por una escala uniforme 's'
+  // (M^T M = s^2 I salvo redondeo, sin reflejo): las normales giran igual
+  // que los puntos
+  bool uniformScale(float &s) const {
+    float g[3][3];
+    gram(g);
+    float s2 = (g[0][0] + g[1][1] + g[2][2]) / 3.0f;
+    float tol = 1e-4f * s2;
+    for (int i = 0; i < 3; i++)
+      for (int j = 0; j < 3; j++)
+        if (std::abs(g[i][j] - (i == j ? s2 : 0.0f)) > tol)
+          return false;
+    s = std::sqrt(s2);
+    return s2 > 0 && determinant3() > 0;
+  }
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef VEC3ARRAY_H
+#define VEC3ARRAY_H
+
+#include "../Core/MappedArray.h"
+#include "Vec3.h"
+#include <initializer_list>
+
+// Arreglo de Vec3 en formato SoA: x[], y[] y z[] separados y alineados para
+// que los kernels SIMD carguen 8 componentes de golpe. Cada componente puede
+// apuntar directamente a un archivo proyectado (ver MeshCache).
+struct Vec3Array {
+  MappedArray<float> x, y, z;
+
+  Vec3Array() = default;
+  Vec3Array(std::initializer_list<Vec3> list) { *this = list; }
+
+  Vec3Array &operator=(std::initializer_list<Vec3> list) {
+    clear();
+    reserve(list.size());
+    for (const auto &v : list)
+      push_back(v);
+    return *this;
+  }
+
+  size_t size() const { return x.size(); }
+  bool empty() const { return x.empty(); }
+
+  void clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+  }
+
+  void reserve(size_t n) {
+    x.reserve(n);
+    y.reserve(n);
+    z.reserve(n);
+  }
+
+  void resize(size_t n, const Vec3 &v = Vec3()) {
+    x.resize(n, v.x);
+    y.resize(n, v.y);
+    z.resize(n, v.z);
+  }
+
+  void push_back(const Vec3 &v) {
+    x.push_back(v.x);
+    y.push_back(v.y);
+    z.push_back(v.z);
+  }
+
+  Vec3 operator[](size_t i) const { return Vec3(x[i], y[i], z[i]); }
+
+  void set(size_t i, const Vec3 &v) {
+    x[i] = v.x;
+    y[i] = v.y;
+    z[i] = v.z;
+  }
+};
+
+#endif
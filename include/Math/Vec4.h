@@ -0,0 +1,17 @@
+#ifndef VEC4_H
+#define VEC4_H
+
+#include "Vec3.h"
+
+// Coordenadas homogeneas (espacio de recorte)
+struct Vec4 {
+  float x, y, z, w;
+
+  Vec4() : x(0), y(0), z(0), w(0) {}
+  Vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+  Vec4(const Vec3 &v, float w) : x(v.x), y(v.y), z(v.z), w(w) {}
+
+  Vec3 xyz() const { return Vec3(x, y, z); }
+};
+
+#endif
@@ -0,0 +1,72 @@
+#include "../include/Graphics/FrameSink.h"
+#include <memory>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace FrameSinks {
+
+bool validPattern(const std::string &pattern) {
+  int conversions = 0;
+  for (size_t i = 0; i < pattern.size(); i++) {
+    if (pattern[i] != '%')
+      continue;
+    if (++i < pattern.size() && pattern[i] == '%')
+      continue;
+    // Ancho opcional (con o sin ceros a la izquierda) y luego 'd'
+    size_t digits = 0;
+    while (i < pattern.size() && pattern[i] >= '0' && pattern[i] <= '9') {
+      i++;
+      digits++;
+    }
+    if (digits > 2 || i >= pattern.size() || pattern[i] != 'd')
+      return false;
+    conversions++;
+  }
+  return conversions == 1;
+}
+
+FrameSink ppmFiles(const std::string &pattern) {
+  if (!validPattern(pattern))
+    return nullptr;
+  // Fila RGB reutilizada entre frames
+  auto row = std::make_shared<std::vector<uint8_t>>();
+  return [pattern, row](const Frame &f) {
+    char path[1024];
+    std::snprintf(path, sizeof(path), pattern.c_str(), f.index);
+    FILE *out = std::fopen(path, "wb");
+    if (!out)
+      return false;
+    std::fprintf(out, "P6\n%d %d\n255\n", f.width, f.height);
+    row->resize((size_t)f.width * 3);
+    bool ok = true;
+    for (int y = 0; y < f.height && ok; y++) {
+      const uint32_t *src = f.pixels + (size_t)y * f.width;
+      uint8_t *dst = row->data();
+      for (int x = 0; x < f.width; x++) {
+        *dst++ = (uint8_t)(src[x] >> 16);
+        *dst++ = (uint8_t)(src[x] >> 8);
+        *dst++ = (uint8_t)src[x];
+      }
+      ok = std::fwrite(row->data(), 1, row->size(), out) == row->size();
+    }
+    return std::fclose(out) == 0 && ok;
+  };
+}
+
+FrameSink rawPipe(FILE *out) {
+#ifdef _WIN32
+  _setmode(_fileno(out), _O_BINARY); // Sin traducir '\n' a "\r\n"
+#endif
+  return [out](const Frame &f) {
+    size_t count = (size_t)f.width * f.height;
+    if (std::fwrite(f.pixels, sizeof(uint32_t), count, out) != count)
+      return false;
+    return std::fflush(out) == 0;
+  };
+}
+
+} // namespace FrameSinks
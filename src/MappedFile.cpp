@@ -0,0 +1,96 @@
+#include "../include/Core/MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &path) {
+  close();
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  fileHandle = file;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    close();
+    return false;
+  }
+  length = (size_t)size.QuadPart;
+  if (length == 0)
+    return true; // No se puede proyectar un archivo vacio
+
+  mapHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapHandle) {
+    close();
+    return false;
+  }
+  ptr = (const char *)MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+  if (!ptr) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::close() {
+  if (ptr)
+    UnmapViewOfFile(ptr);
+  if (mapHandle)
+    CloseHandle(mapHandle);
+  if (fileHandle)
+    CloseHandle(fileHandle);
+  ptr = nullptr;
+  mapHandle = nullptr;
+  fileHandle = nullptr;
+  length = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string &path) {
+  close();
+  fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close();
+    return false;
+  }
+  length = (size_t)st.st_size;
+  if (length == 0)
+    return true; // No se puede proyectar un archivo vacio
+
+  void *p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (p == MAP_FAILED) {
+    close();
+    return false;
+  }
+  madvise(p, length, MADV_SEQUENTIAL);
+  ptr = (const char *)p;
+  return true;
+}
+
+void MappedFile::close() {
+  if (ptr)
+    munmap((void *)ptr, length);
+  if (fd >= 0)
+    ::close(fd);
+  ptr = nullptr;
+  fd = -1;
+  length = 0;
+}
+
+#endif
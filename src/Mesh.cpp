@@ -1,4 +1,8 @@
 #include "../include/Graphics/Mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
 
 void Mesh::addCube() {
   // Vertices del cubo (-1 a 1)
@@ -32,4 +36,263 @@ void Mesh::addCube() {
            // Bottom
            {5, 7, 0, 0x00FFFF},
            {5, 0, 3, 0x00FFFF}};
+
+  computeNormals();
+  computeBounds();
+}
+
+// Esfera centrada en la caja de 'count' vertices; el radio es la mayor
+// distancia al centro (mas ajustado que media diagonal)
+template <typename IndexAt>
+static void boundingSphere(const Vec3Array &vertices, size_t count,
+                           IndexAt index, Vec3 &center, float &radius) {
+  Vec3 lo = vertices[index(0)], hi = lo;
+  for (size_t k = 1; k < count; k++) {
+    Vec3 v = vertices[index(k)];
+    lo = Vec3(std::min(lo.x, v.x), std::min(lo.y, v.y), std::min(lo.z, v.z));
+    hi = Vec3(std::max(hi.x, v.x), std::max(hi.y, v.y), std::max(hi.z, v.z));
+  }
+  center = (lo + hi) * 0.5f;
+  float r2 = 0;
+  for (size_t k = 0; k < count; k++) {
+    Vec3 d = vertices[index(k)] - center;
+    r2 = std::max(r2, d.dot(d));
+  }
+  radius = std::sqrt(r2);
+}
+
+void Mesh::computeBounds() {
+  boundsMin = boundsMax = boundsCenter = Vec3();
+  boundsRadius = -1.0f;
+  if (vertices.empty())
+    return;
+  boundsMin = boundsMax = vertices[0];
+  for (size_t i = 1; i < vertices.size(); i++) {
+    Vec3 v = vertices[i];
+    boundsMin.x = std::min(boundsMin.x, v.x);
+    boundsMin.y = std::min(boundsMin.y, v.y);
+    boundsMin.z = std::min(boundsMin.z, v.z);
+    boundsMax.x = std::max(boundsMax.x, v.x);
+    boundsMax.y = std::max(boundsMax.y, v.y);
+    boundsMax.z = std::max(boundsMax.z, v.z);
+  }
+  boundingSphere(vertices, vertices.size(), [](size_t k) { return k; },
+                 boundsCenter, boundsRadius);
+}
+
+// Normal unitaria de la cara (cero si es degenerada)
+static Vec3 faceNormal(const Vec3Array &vertices, const Face &f) {
+  Vec3 a = vertices[f.a];
+  Vec3 n = (vertices[f.b] - a).cross(vertices[f.c] - a);
+  n.normalize();
+  return n;
+}
+
+// Cotas del cluster de caras [first, end): rango de vertices, esfera y cono
+// de normales. El eje es la normal media y el corte el seno del semiangulo
+// (coneCutoff > 1 si el cono es demasiado abierto para descartar nada).
+static MeshCluster makeCluster(const Vec3Array &vertices, const Face *faces,
+                               uint32_t first, uint32_t end) {
+  const Face *f = faces + first;
+  uint32_t count = end - first;
+  MeshCluster c = {first, count, (uint32_t)f[0].a, 0, Vec3(), 0, Vec3(), 2};
+  Vec3 sum;
+  for (uint32_t k = 0; k < count; k++) {
+    int lo = std::min({f[k].a, f[k].b, f[k].c});
+    int hi = std::max({f[k].a, f[k].b, f[k].c});
+    c.firstVertex = std::min(c.firstVertex, (uint32_t)lo);
+    c.endVertex = std::max(c.endVertex, (uint32_t)hi + 1);
+    sum = sum + faceNormal(vertices, f[k]);
+  }
+  // Cada esquina de cada cara (los repetidos no cambian la esfera)
+  boundingSphere(
+      vertices, (size_t)count * 3,
+      [f](size_t k) {
+        const Face &face = f[k / 3];
+        return (size_t)(k % 3 == 0 ? face.a : k % 3 == 1 ? face.b : face.c);
+      },
+      c.center, c.radius);
+
+  if (sum.length() == 0)
+    return c;
+  c.coneAxis = sum;
+  c.coneAxis.normalize();
+  float minDot = 1.0f;
+  for (uint32_t k = 0; k < count; k++) {
+    Vec3 n = faceNormal(vertices, f[k]);
+    if (n.length() > 0) // Las degeneradas nunca se ven
+      minDot = std::min(minDot, c.coneAxis.dot(n));
+  }
+  if (minDot > 0)
+    c.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+  return c;
+}
+
+// Orden de caras agrupado en meshlets: cada uno arranca en la primera cara
+// libre y crece por adyacencia tomando la cara candidata mas cercana a su
+// centro, hasta maxFaces. Pasado minFaces no acepta caras que se aparten
+// de la normal media, para que el cono quede cerrado. 'sizes' recibe las
+// caras de cada meshlet.
+static void growMeshlets(const Vec3Array &vertices,
+                         const MappedArray<Face> &faces, uint32_t maxFaces,
+                         uint32_t minFaces, float coneSplit,
+                         std::vector<uint32_t> &order,
+                         std::vector<uint32_t> &sizes) {
+  uint32_t total = (uint32_t)faces.size();
+  size_t nv = vertices.size();
+
+  // Caras de cada vertice, en un arreglo plano
+  std::vector<uint32_t> adjStart(nv + 1, 0), adj((size_t)total * 3);
+  for (const Face &f : faces)
+    for (int v : {f.a, f.b, f.c})
+      adjStart[v + 1]++;
+  for (size_t v = 0; v < nv; v++)
+    adjStart[v + 1] += adjStart[v];
+  std::vector<uint32_t> cursor(adjStart.begin(), adjStart.end() - 1);
+  for (uint32_t k = 0; k < total; k++)
+    for (int v : {faces[k].a, faces[k].b, faces[k].c})
+      adj[cursor[v]++] = k;
+
+  std::vector<Vec3> normal(total), centroid(total);
+  for (uint32_t k = 0; k < total; k++) {
+    const Face &f = faces[k];
+    normal[k] = faceNormal(vertices, f);
+    centroid[k] = (vertices[f.a] + vertices[f.b] + vertices[f.c]) / 3.0f;
+  }
+
+  std::vector<uint8_t> used(total, 0);
+  std::vector<uint32_t> candidates, stamp(total, UINT32_MAX);
+  std::vector<uint32_t> inMeshlet(nv, UINT32_MAX); // Id del ultimo meshlet
+  order.clear();
+  order.reserve(total);
+  sizes.clear();
+  for (uint32_t seed = 0, id = 0; order.size() < total; id++) {
+    while (used[seed])
+      seed++;
+    candidates.assign(1, seed);
+    stamp[seed] = id;
+    Vec3 normalSum, centerSum;
+    uint32_t count = 0;
+    while (count < maxFaces && !candidates.empty()) {
+      Vec3 axis = normalSum;
+      axis.normalize();
+      Vec3 center = count ? centerSum / (float)count : Vec3();
+      size_t best = count ? candidates.size() : 0;
+      int bestShared = 0;
+      float bestDist = INFINITY;
+      for (size_t i = 0; count && i < candidates.size(); i++) {
+        uint32_t g = candidates[i];
+        if (count >= minFaces && normal[g].length() > 0 &&
+            axis.dot(normal[g]) < coneSplit)
+          continue;
+        // Primero las que comparten mas vertices (rellenan entrantes)
+        int shared = 0;
+        for (int v : {faces[g].a, faces[g].b, faces[g].c})
+          shared += inMeshlet[v] == id;
+        Vec3 d = centroid[g] - center;
+        float dist = d.dot(d);
+        if (shared > bestShared || (shared == bestShared && dist < bestDist)) {
+          best = i;
+          bestShared = shared;
+          bestDist = dist;
+        }
+      }
+      if (best == candidates.size())
+        break;
+
+      uint32_t g = candidates[best];
+      candidates[best] = candidates.back();
+      candidates.pop_back();
+      used[g] = 1;
+      order.push_back(g);
+      count++;
+      normalSum = normalSum + normal[g];
+      centerSum = centerSum + centroid[g];
+      for (int v : {faces[g].a, faces[g].b, faces[g].c}) {
+        inMeshlet[v] = id;
+        for (uint32_t j = adjStart[v]; j < adjStart[v + 1]; j++) {
+          uint32_t h = adj[j];
+          if (!used[h] && stamp[h] != id) {
+            stamp[h] = id;
+            candidates.push_back(h);
+          }
+        }
+      }
+    }
+    sizes.push_back(count);
+  }
+}
+
+void Mesh::buildClusters(uint32_t maxFaces, uint32_t minFaces) {
+  clusters.clear();
+  if (maxFaces == 0 || faces.empty())
+    return;
+  std::vector<uint32_t> order, sizes;
+  growMeshlets(vertices, faces, maxFaces, std::min(minFaces, maxFaces),
+               CLUSTER_CONE_SPLIT, order, sizes);
+
+  // Vertices renumerados por primer uso, para que los de cada meshlet
+  // queden juntos y su rango sea corto; los que no usa nadie van al final
+  size_t nv = vertices.size();
+  std::vector<int> remap(nv, -1);
+  int next = 0;
+  for (uint32_t g : order)
+    for (int v : {faces[g].a, faces[g].b, faces[g].c})
+      if (remap[v] < 0)
+        remap[v] = next++;
+  for (size_t v = 0; v < nv; v++)
+    if (remap[v] < 0)
+      remap[v] = next++;
+
+  bool withNormals = hasNormals();
+  Vec3Array newVertices, newNormals;
+  newVertices.resize(nv);
+  if (withNormals)
+    newNormals.resize(nv);
+  for (size_t v = 0; v < nv; v++) {
+    newVertices.set(remap[v], vertices[v]);
+    if (withNormals)
+      newNormals.set(remap[v], normals[v]);
+  }
+  MappedArray<Face> newFaces;
+  newFaces.resize(order.size());
+  for (size_t k = 0; k < order.size(); k++) {
+    const Face &f = faces[order[k]];
+    newFaces[k] = {remap[f.a], remap[f.b], remap[f.c], f.color};
+  }
+  vertices = std::move(newVertices);
+  if (withNormals)
+    normals = std::move(newNormals);
+  faces = std::move(newFaces);
+
+  const Face *sorted = faces.data();
+  uint32_t first = 0;
+  for (uint32_t size : sizes) {
+    clusters.push_back(makeCluster(vertices, sorted, first, first + size));
+    first += size;
+  }
+}
+
+bool Mesh::hasClusters() const {
+  if (clusters.empty())
+    return false;
+  const MeshCluster &last = clusters[clusters.size() - 1];
+  return last.firstFace + last.faceCount == faces.size();
+}
+
+void Mesh::computeNormals(Vec3Array &out) const {
+  out.clear();
+  out.resize(vertices.size());
+  for (const auto &f : faces) {
+    Vec3 a = vertices[f.a];
+    Vec3 n = (vertices[f.b] - a).cross(vertices[f.c] - a);
+    out.set(f.a, out[f.a] + n);
+    out.set(f.b, out[f.b] + n);
+    out.set(f.c, out[f.c] + n);
+  }
+  for (size_t i = 0; i < out.size(); i++) {
+    Vec3 n = out[i];
+    n.normalize();
+    out.set(i, n);
+  }
 }
@@ -0,0 +1,174 @@
+#include "../include/Graphics/MeshCache.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+static_assert(sizeof(MeshCache::Header) % MeshCache::BLOCK_ALIGN == 0,
+              "la cabecera debe dejar el primer bloque alineado");
+
+static const char MAGIC[8] = {'C', 'U', 'B', 'E', 'M', 'E', 'S', 'H'};
+
+static size_t alignUp(size_t n) {
+  return (n + MeshCache::BLOCK_ALIGN - 1) & ~(MeshCache::BLOCK_ALIGN - 1);
+}
+
+// Tamano y fecha de modificacion del archivo de origen
+static bool sourceStamp(const std::string &source, uint64_t &size,
+                        int64_t &time) {
+  std::error_code ec;
+  size = (uint64_t)fs::file_size(source, ec);
+  if (ec)
+    return false;
+  auto stamp = fs::last_write_time(source, ec);
+  if (ec)
+    return false;
+  time = (int64_t)stamp.time_since_epoch().count();
+  return true;
+}
+
+bool MeshCache::load(const std::string &source, Mesh &mesh) {
+  uint64_t size;
+  int64_t time;
+  if (!sourceStamp(source, size, time))
+    return false;
+
+  auto file = std::make_shared<MappedFile>();
+  if (!file->open(pathFor(source)) || file->size() < sizeof(Header))
+    return false;
+
+  Header h;
+  std::memcpy(&h, file->data(), sizeof(Header));
+  if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      h.version != VERSION || h.faceSize != sizeof(Face) ||
+      h.clusterSize != sizeof(MeshCluster) || h.sourceSize != size ||
+      h.sourceTime != time)
+    return false;
+
+  // Cada bloque debe estar alineado y caber en el archivo
+  uint64_t limit = file->size();
+  if (h.vertexCount > limit || h.faceCount > limit || h.clusterCount > limit)
+    return false;
+  for (int b = 0; b < BLOCK_COUNT; b++) {
+    uint64_t bytes = b < 6    ? h.vertexCount * sizeof(float)
+                     : b == 6 ? h.faceCount * sizeof(Face)
+                              : h.clusterCount * sizeof(MeshCluster);
+    if (h.blocks[b] % BLOCK_ALIGN != 0 || h.blocks[b] > limit ||
+        bytes > limit - h.blocks[b])
+      return false;
+  }
+
+  const char *base = file->data();
+  auto block = [&](int b) {
+    return reinterpret_cast<const float *>(base + h.blocks[b]);
+  };
+  const Face *faces = reinterpret_cast<const Face *>(base + h.blocks[6]);
+  const MeshCluster *clusters =
+      reinterpret_cast<const MeshCluster *>(base + h.blocks[7]);
+
+  // Indices dentro de rango, igual que lo que deja pasar el parser: una
+  // cache danada se descarta y se vuelve a leer el .obj. Los clusters van
+  // seguidos desde la cara 0 y sus caras solo usan vertices de su rango,
+  // que es lo unico que el render transforma si el cluster es visible.
+  auto inside = [faces](uint64_t k, uint64_t begin, uint64_t end) {
+    const Face &f = faces[k];
+    return (uint32_t)f.a >= begin && (uint32_t)f.a < end &&
+           (uint32_t)f.b >= begin && (uint32_t)f.b < end &&
+           (uint32_t)f.c >= begin && (uint32_t)f.c < end;
+  };
+  uint64_t face = 0;
+  for (uint64_t k = 0; k < h.clusterCount; k++) {
+    const MeshCluster &c = clusters[k];
+    if (c.firstFace != face || c.faceCount > h.faceCount - face ||
+        c.firstVertex > c.endVertex || c.endVertex > h.vertexCount)
+      return false;
+    for (uint64_t end = face + c.faceCount; face < end; face++)
+      if (!inside(face, c.firstVertex, c.endVertex))
+        return false;
+  }
+  for (; face < h.faceCount; face++) // Caras fuera de todo cluster
+    if (!inside(face, 0, h.vertexCount))
+      return false;
+
+  size_t n = (size_t)h.vertexCount;
+  mesh.vertices.x.attach(block(0), n);
+  mesh.vertices.y.attach(block(1), n);
+  mesh.vertices.z.attach(block(2), n);
+  mesh.normals.x.attach(block(3), n);
+  mesh.normals.y.attach(block(4), n);
+  mesh.normals.z.attach(block(5), n);
+  mesh.faces.attach(faces, (size_t)h.faceCount);
+  mesh.clusters.attach(clusters, (size_t)h.clusterCount);
+  mesh.boundsMin = Vec3(h.boundsMin[0], h.boundsMin[1], h.boundsMin[2]);
+  mesh.boundsMax = Vec3(h.boundsMax[0], h.boundsMax[1], h.boundsMax[2]);
+  mesh.boundsCenter =
+      Vec3(h.boundsCenter[0], h.boundsCenter[1], h.boundsCenter[2]);
+  mesh.boundsRadius = h.boundsRadius;
+  mesh.storage = std::move(file);
+  return true;
+}
+
+bool MeshCache::save(const std::string &source, const Mesh &mesh) {
+  Header h = {};
+  std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+  h.version = VERSION;
+  h.faceSize = sizeof(Face);
+  h.vertexCount = mesh.vertices.size();
+  h.clusterSize = sizeof(MeshCluster);
+  h.faceCount = mesh.faces.size();
+  h.clusterCount = mesh.clusters.size();
+  if (!sourceStamp(source, h.sourceSize, h.sourceTime) || !mesh.hasNormals())
+    return false;
+  h.boundsMin[0] = mesh.boundsMin.x;
+  h.boundsMin[1] = mesh.boundsMin.y;
+  h.boundsMin[2] = mesh.boundsMin.z;
+  h.boundsMax[0] = mesh.boundsMax.x;
+  h.boundsMax[1] = mesh.boundsMax.y;
+  h.boundsMax[2] = mesh.boundsMax.z;
+  h.boundsCenter[0] = mesh.boundsCenter.x;
+  h.boundsCenter[1] = mesh.boundsCenter.y;
+  h.boundsCenter[2] = mesh.boundsCenter.z;
+  h.boundsRadius = mesh.boundsRadius;
+
+  const void *data[BLOCK_COUNT] = {
+      mesh.vertices.x.data(), mesh.vertices.y.data(), mesh.vertices.z.data(),
+      mesh.normals.x.data(),  mesh.normals.y.data(),  mesh.normals.z.data(),
+      mesh.faces.data(),      mesh.clusters.data()};
+  size_t bytes[BLOCK_COUNT];
+  size_t offset = alignUp(sizeof(Header));
+  for (int b = 0; b < BLOCK_COUNT; b++) {
+    bytes[b] = b < 6    ? mesh.vertices.size() * sizeof(float)
+               : b == 6 ? mesh.faces.size() * sizeof(Face)
+                        : mesh.clusters.size() * sizeof(MeshCluster);
+    h.blocks[b] = offset;
+    offset = alignUp(offset + bytes[b]);
+  }
+
+  std::string path = pathFor(source), tmp = path + ".tmp";
+  std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+  if (!out)
+    return false;
+  static const char zeros[BLOCK_ALIGN] = {};
+  out.write(reinterpret_cast<const char *>(&h), sizeof(Header));
+  size_t pos = sizeof(Header);
+  for (int b = 0; b < BLOCK_COUNT; b++) {
+    out.write(zeros, (std::streamsize)(h.blocks[b] - pos));
+    out.write(static_cast<const char *>(data[b]), (std::streamsize)bytes[b]);
+    pos = h.blocks[b] + bytes[b];
+  }
+  out.close();
+
+  std::error_code ec;
+  if (!out) {
+    fs::remove(tmp, ec);
+    return false;
+  }
+  fs::rename(tmp, path, ec);
+  if (ec) {
+    fs::remove(tmp, ec);
+    return false;
+  }
+  return true;
+}
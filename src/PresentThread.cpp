@@ -0,0 +1,84 @@
+#include "../include/Graphics/PresentThread.h"
+#include <algorithm>
+#include <future>
+
+bool PresentThread::start(int count, size_t pixels, Hooks h) {
+  stop();
+  count = std::max(1, std::min(count, MAX_BUFFERS));
+  hooks = std::move(h);
+  buffers.assign(count, std::vector<uint32_t>(pixels));
+  freeBuffers.reset();
+  readyFrames.reset();
+  for (int k = 0; k < count; k++)
+    freeBuffers.push(k);
+  current = -1;
+  quit = false;
+  deliverFailed = false;
+
+  // setup corre en el hilo nuevo: SDL exige renderizar desde el hilo que
+  // creo el SDL_Renderer
+  std::promise<bool> ready;
+  std::future<bool> started = ready.get_future();
+  worker = std::thread([this, ready = std::move(ready)]() mutable {
+    bool ok = !hooks.setup || hooks.setup();
+    ready.set_value(ok);
+    if (!ok)
+      return;
+    loop();
+    if (hooks.teardown)
+      hooks.teardown();
+  });
+  if (!started.get()) {
+    worker.join();
+    return false;
+  }
+  return true;
+}
+
+void PresentThread::stop() {
+  if (!worker.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    quit = true;
+  }
+  cvReady.notify_one();
+  worker.join();
+  buffers.clear();
+}
+
+uint32_t *PresentThread::acquire() {
+  if (current < 0 && !freeBuffers.pop(current)) {
+    std::unique_lock<std::mutex> lock(mtx);
+    cvFree.wait(lock, [this] { return freeBuffers.pop(current); });
+  }
+  return buffers[current].data();
+}
+
+void PresentThread::submit(int frame) {
+  if (current < 0)
+    acquire();
+  readyFrames.push({current, frame}); // Nunca llena: hay N buffers y N slots
+  current = -1;
+  // Pasar por el mutex evita perder el aviso si el otro hilo esta por dormir
+  { std::lock_guard<std::mutex> lock(mtx); }
+  cvReady.notify_one();
+}
+
+void PresentThread::loop() {
+  for (;;) {
+    Slot s;
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      cvReady.wait(lock, [this] { return quit || !readyFrames.empty(); });
+    }
+    // Al detenerse se vacia la cola antes de salir
+    if (!readyFrames.pop(s))
+      return;
+    if (!hooks.deliver(buffers[s.buffer].data(), s.frame))
+      deliverFailed = true;
+    freeBuffers.push(s.buffer);
+    { std::lock_guard<std::mutex> lock(mtx); }
+    cvFree.notify_one();
+  }
+}
@@ -0,0 +1,71 @@
+#include "../include/Core/ThreadPool.h"
+
+ThreadPool::ThreadPool(int threads) {
+  if (threads <= 0)
+    threads = (int)std::thread::hardware_concurrency();
+  for (int i = 1; i < threads; i++)
+    workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    stop = true;
+  }
+  cvWork.notify_all();
+  for (auto &t : workers)
+    t.join();
+}
+
+void ThreadPool::run(int count, Task task, void *ctx) {
+  // Sin trabajadores o con un solo elemento no vale la pena despertar a nadie
+  if (workers.empty() || count <= 1) {
+    for (int i = 0; i < count; i++)
+      task(ctx, i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    jobTask = task;
+    jobCtx = ctx;
+    jobCount = count;
+    next.store(0);
+    active = (int)workers.size();
+    generation++;
+  }
+  cvWork.notify_all();
+
+  drain();
+
+  std::unique_lock<std::mutex> lock(mtx);
+  cvDone.wait(lock, [this] { return active == 0; });
+}
+
+void ThreadPool::drain() {
+  for (;;) {
+    int i = next.fetch_add(1);
+    if (i >= jobCount)
+      break;
+    jobTask(jobCtx, i);
+  }
+}
+
+void ThreadPool::workerLoop() {
+  unsigned seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      cvWork.wait(lock, [&] { return stop || generation != seen; });
+      if (stop)
+        return;
+      seen = generation;
+    }
+
+    drain();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (--active == 0)
+      cvDone.notify_one();
+  }
+}
@@ -2,15 +2,91 @@
 #include "../include/Graphics/OBJLoader.h"
 #include "../include/Graphics/Renderer.h"
 #include <SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
+
+// Opciones de linea de comandos
+struct Options {
+  int width = 800, height = 600;
+  std::string model = "model.obj";
+  bool headless = false;
+  int frames = 300;                   // Solo sin ventana
+  std::string out = "frame_%04d.ppm"; // Patron de archivos PPM
+  bool pipe = false;                  // Frames crudos a stdout
+  int buffers = 1; // > 1: presentacion en otro hilo con N buffers
+};
+
+static void usage(const char *program) {
+  std::cerr << "Uso: " << program << " [opciones]\n"
+            << "  --model <archivo.obj>  Modelo a cargar (model.obj)\n"
+            << "  --size <ancho>x<alto>  Resolucion (800x600)\n"
+            << "  --headless             Sin ventana ni SDL video\n"
+            << "  --frames <n>           Frames a generar sin ventana (300)\n"
+            << "  --out <patron>         PPM por frame (frame_%04d.ppm),"
+               " un solo %d\n"
+            << "  --pipe                 ARGB8888 crudo a stdout\n"
+            << "  --buffers <n>          Presentar en otro hilo con n buffers"
+               " (1-8)\n";
+}
+
+static bool parseArgs(int argc, char *argv[], Options &opt) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *next = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!std::strcmp(arg, "--headless")) {
+      opt.headless = true;
+    } else if (!std::strcmp(arg, "--pipe")) {
+      opt.headless = opt.pipe = true;
+    } else if (!std::strcmp(arg, "--model") && next) {
+      opt.model = argv[++i];
+    } else if (!std::strcmp(arg, "--out") && next) {
+      opt.out = argv[++i];
+      opt.headless = true;
+      if (!FrameSinks::validPattern(opt.out)) {
+        std::cerr << "Patron de --out invalido: " << opt.out << "\n";
+        return false;
+      }
+    } else if (!std::strcmp(arg, "--frames") && next) {
+      opt.frames = std::atoi(argv[++i]);
+      opt.headless = true;
+    } else if (!std::strcmp(arg, "--buffers") && next) {
+      opt.buffers = std::atoi(argv[++i]);
+      if (opt.buffers < 1 || opt.buffers > PresentThread::MAX_BUFFERS)
+        return false;
+    } else if (!std::strcmp(arg, "--size") && next) {
+      if (std::sscanf(argv[++i], "%dx%d", &opt.width, &opt.height) != 2 ||
+          opt.width <= 0 || opt.height <= 0)
+        return false;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
 
 int main(int argc, char *argv[]) {
   // Configuración
-  const int WIDTH = 800;
-  const int HEIGHT = 600;
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    usage(argv[0]);
+    return 1;
+  }
+  // Con --pipe stdout lleva los frames: los mensajes van a stderr
+  if (opt.pipe)
+    std::cout.rdbuf(std::cerr.rdbuf());
 
-  Renderer renderer(WIDTH, HEIGHT);
-  if (!renderer.init()) {
+  Renderer renderer(opt.width, opt.height);
+  if (opt.headless) {
+    FrameSink sink = opt.pipe ? FrameSinks::rawPipe()
+                              : FrameSinks::ppmFiles(opt.out);
+    if (!renderer.initHeadless(sink, opt.buffers)) {
+      std::cerr << "Fallo al iniciar el modo sin ventana.\n";
+      return 1;
+    }
+  } else if (!renderer.init(opt.buffers)) {
     std::cerr << "Fallo al iniciar SDL.\n";
     return 1;
   }
@@ -18,16 +94,36 @@ int main(int argc, char *argv[]) {
   // Cargar Modelo
   Mesh mesh;
   // Intentamos cargar un OBJ si existe, si no, cargamos el cubo por defecto
-  if (!OBJLoader::load("model.obj", mesh)) {
-    std::cout << "No se encontro model.obj, cargando cubo por defecto.\n";
+  if (!OBJLoader::load(opt.model, mesh)) {
+    std::cout << "No se encontro " << opt.model
+              << ", cargando cubo por defecto.\n";
     mesh.addCube();
   }
 
+  float angleX = 0, angleY = 0, angleZ = 0;
+
+  // Sin ventana: sin eventos ni limite de FPS, cada frame va al sink
+  if (opt.headless) {
+    int status = 0;
+    for (int frame = 0; frame < opt.frames; frame++) {
+      angleX += 0.01f;
+      angleY += 0.01f;
+      angleZ += 0.01f;
+      renderer.clear(0x000000);
+      renderer.renderMesh(mesh, angleX, angleY, angleZ);
+      if (!renderer.present()) {
+        std::cerr << "Error al escribir el frame " << frame << ".\n";
+        status = 1;
+        break;
+      }
+    }
+    renderer.destroy();
+    return status;
+  }
+
   bool isRunning = true;
   SDL_Event event;
 
-  float angleX = 0, angleY = 0, angleZ = 0;
-
   // Control de Tiempo (60 FPS)
   const int FPS = 60;
   const int FRAME_DELAY = 1000 / FPS;
@@ -70,6 +166,43 @@ int main(int argc, char *argv[]) {
         case SDLK_p:
           renderer.togglePerspective();
           break;
+        case SDLK_7:
+        case SDLK_r:
+          renderer.toggleRasterizer();
+          break;
+        case SDLK_8:
+        case SDLK_s:
+          renderer.toggleSimd();
+          break;
+        case SDLK_9:
+        case SDLK_t:
+          renderer.toggleTiles();
+          break;
+        case SDLK_0:
+        case SDLK_d:
+          renderer.toggleDirectPresent();
+          break;
+        case SDLK_z:
+          renderer.toggleLazyClear();
+          break;
+        case SDLK_h:
+          renderer.toggleHiZ();
+          break;
+        case SDLK_o:
+          renderer.toggleDepthSort();
+          break;
+        case SDLK_x:
+          renderer.toggleZPrepass();
+          break;
+        case SDLK_b:
+          renderer.toggleVisibility();
+          break;
+        case SDLK_k:
+          renderer.toggleFrustumCull();
+          break;
+        case SDLK_n:
+          renderer.toggleConeCull();
+          break;
         }
       }
     }